@@ -6,379 +6,107 @@ A 2D algorithm that combines Peano (3x3) and Hilbert (2x2) blocks was published
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include "draw_sfc.h"
+#include "draw_sfc_core.h"
 
-#define msg(a...) while(1) { printf(a); printf("\n"); break; }
+//the public functions run the core with a stack buffer and hand each batch to its output
 
+#define SFC_BATCH 1024
 
-typedef void (*RenderCallback)(int x, int y, void * ctx);
-
-static void go_ctx(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir, RenderCallback cb, void *ctx);
-
-#define render(x0, y0, dir0)  cb(x0,y0,ctx)
-#define go(x0, y0, dxl, dyl, dxr, dyr, dir) go_ctx(x0, y0, dxl, dyl, dxr, dyr, dir,cb,ctx)
+typedef struct cb_ctx { RenderCallback cb; void *ctx; } cb_ctx;
+typedef struct inverse_ctx { uint32_t *idx; int ww; } inverse_ctx;
 
+static int flush_cb(const sfc_point *pts, size_t n, uint64_t first, void *ctx)
+{ const cb_ctx *c=ctx;
+  size_t i;
+  (void)first;
+  for (i=0; i<n; i++) c->cb(pts[i].x,pts[i].y,c->ctx);
+  return 0;
+}
+static int flush_xy(const sfc_point *pts, size_t n, uint64_t first, void *ctx)
+{ int32_t **xy=ctx;
+  size_t i;
+  for (i=0; i<n; i++) { xy[0][first+i]=pts[i].x; xy[1][first+i]=pts[i].y; }
+  return 0;
+}
+static int flush_xy16(const sfc_point *pts, size_t n, uint64_t first, void *ctx)
+{ uint16_t *xy=(uint16_t*)ctx+2*first;
+  size_t i;
+  for (i=0; i<n; i++) { xy[2*i]=(uint16_t)pts[i].x; xy[2*i+1]=(uint16_t)pts[i].y; }
+  return 0;
+}
+static int flush_inverse(const sfc_point *pts, size_t n, uint64_t first, void *ctx)
+{ const inverse_ctx *c=ctx;
+  size_t i;
+  for (i=0; i<n; i++) c->idx[(size_t)pts[i].y*c->ww+pts[i].x]=(uint32_t)(first+i);
+  return 0;
+}
 
-void spacefill(int ww,int hh, RenderCallback cb, void *ctx) //left, top, width, height
-{ if (hh>ww) //go top->down
-  { if ((hh%2==1)&&(ww%2==0)) go(0, 0, ww, 0, 0, hh, 'm'); //go diagonal
-    else go(0,0, ww, 0, 0, hh, 'r'); //go top->down
-  }
-  else //go left->right
-  { if ((ww%2==1)&&(hh%2==0)) go(0, 0, ww, 0, 0, hh, 'm'); //go diagonal
-    else go(0, 0, ww, 0, 0, hh, 'l'); //go left->right
-  }
+void spacefill(int ww,int hh, RenderCallback cb, void *ctx) //width, height, callback, callback context
+{ sfc_point buf[SFC_BATCH];
+  cb_ctx c;
+  c.cb=cb; c.ctx=ctx;
+  sfc_fill(ww,hh, buf,SFC_BATCH, flush_cb,&c);
 }
-static void go_ctx(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir, RenderCallback cb, void *ctx)
-{ //x0, y0: start corner looking to the center of the rectangle
-  //dxl, dyl: vector from the start corner to the left corner of the rectangle
-  //dxr, dyr: vector from the start corner to the right corner of the rectangle
-  //dir: direction to go - "l"=left, "m"=middle, "r"=right
-  //msg("go: "+x0+", "+y0+", "+dxl+", "+dyl+", "+dxr+", "+dyr+", "+dir);
-  //render if 2x3 or smaller
-  if (abs((dxl+dyl)*(dxr+dyr))<=6)
-  { int ddx, ddy, ii;
-    if (abs(dxl+dyl)==1)
-    { ddx=dxr/abs(dxr+dyr);
-      ddy=dyr/abs(dxr+dyr);
-      for (ii=0; ii<abs(dxr+dyr); ii++)
-        render(x0+ii*ddx+(dxl+ddx-1)/2, y0+ii*ddy+(dyl+ddy-1)/2, dir);
-      return;
-    }
-    if (abs(dxr+dyr)==1)
-    { ddx=dxl/abs(dxl+dyl);
-      ddy=dyl/abs(dxl+dyl);
-      for (ii=0; ii<abs(dxl+dyl); ii++)
-        render(x0+ii*ddx+(dxr+ddx-1)/2, y0+ii*ddy+(dyr+ddy-1)/2, dir);
-      return;
-    }
-    if (dir=='l')
-    { ddx=dxr/abs(dxr+dyr);
-      ddy=dyr/abs(dxr+dyr);
-      for (ii=0; ii<abs(dxr+dyr); ii++)
-        render(x0+ii*ddx+(dxl/2+ddx-1)/2, y0+ii*ddy+(dyl/2+ddy-1)/2, dir);
-      for (ii=abs(dxr+dyr)-1; ii>=0; ii--)
-        render(x0+ii*ddx+(dxl+dxl/2+ddx-1)/2, y0+ii*ddy+(dyl+dyl/2+ddy-1)/2, dir);
-      return;
-    }
-    if (dir=='r')
-    { ddx=dxl/abs(dxl+dyl);
-      ddy=dyl/abs(dxl+dyl);
-      for (ii=0; ii<abs(dxl+dyl); ii++)
-        render(x0+ii*ddx+(dxr/2+ddx-1)/2, y0+ii*ddy+(dyr/2+ddy-1)/2, dir);
-      for (ii=abs(dxl+dyl)-1; ii>=0; ii--)
-        render(x0+ii*ddx+(dxr+dxr/2+ddx-1)/2, y0+ii*ddy+(dyr+dyr/2+ddy-1)/2, dir);
-      return;
-    }
-    if (dir=='m')
-    { if (abs(dxr+dyr)==3)
-      { ddx=dxr/abs(dxr+dyr);
-        ddy=dyr/abs(dxr+dyr);
-        render(x0+(dxl/2+ddx-1)/2, y0+(dyl/2+ddy-1)/2, dir);
-        render(x0+(dxl+dxl/2+ddx-1)/2, y0+(dyl+dyl/2+ddy-1)/2, dir);
-        render(x0+ddx+(dxl+dxl/2+ddx-1)/2, y0+ddy+(dyl+dyl/2+ddy-1)/2, dir);
-        render(x0+ddx+(dxl/2+ddx-1)/2, y0+ddy+(dyl/2+ddy-1)/2, dir);
-        render(x0+2*ddx+(dxl/2+ddx-1)/2, y0+2*ddy+(dyl/2+ddy-1)/2, dir);
-        render(x0+2*ddx+(dxl+dxl/2+ddx-1)/2, y0+2*ddy+(dyl+dyl/2+ddy-1)/2, dir);
-        return;
-      }
-      if (abs(dxl+dyl)==3)
-      { ddx=dxl/abs(dxl+dyl);
-        ddy=dyl/abs(dxl+dyl);
-        render(x0+(dxr/2+ddx-1)/2, y0+(dyr/2+ddy-1)/2, dir);
-        render(x0+(dxr+dxr/2+ddx-1)/2, y0+(dyr+dyr/2+ddy-1)/2, dir);
-        render(x0+ddx+(dxr+dxr/2+ddx-1)/2, y0+ddy+(dyr+dyr/2+ddy-1)/2, dir);
-        render(x0+ddx+(dxr/2+ddx-1)/2, y0+ddy+(dyr/2+ddy-1)/2, dir);
-        render(x0+2*ddx+(dxr/2+ddx-1)/2, y0+2*ddy+(dyr/2+ddy-1)/2, dir);
-        render(x0+2*ddx+(dxr+dxr/2+ddx-1)/2, y0+2*ddy+(dyr+dyr/2+ddy-1)/2, dir);
-        return;
-      }
-    }
-    msg("renderError");
-    return;
-  }
-  //divide into 2 parts if necessary
-  if (2*(abs(dxl)+abs(dyl))>3*(abs(dxr)+abs(dyr))) //left side much longer than right side
-  { int dxl2=dxl/2;
-    int dyl2=dyl/2;
-    if ((abs(dxr)+abs(dyr))%2==0) //right side is even
-    { if ((abs(dxl)+abs(dyl))%2==0) //make 2 parts from even side
-      { if (dir=='l')
-        { if ((abs(dxl)+abs(dyl))%4==0) //make 2 parts even-even from even side
-          { go(x0, y0, dxl2, dyl2, dxr, dyr, 'l');
-            go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'l');
-          }
-          else //make 2 parts odd-odd from even side
-          { go(x0, y0, dxl2, dyl2, dxr, dyr, 'm');
-            go(x0+dxl2+dxr, y0+dyl2+dyr, -dxr, -dyr, dxl-dxl2, dyl-dyl2, 'm');
-          }
-          return;
-        }
-      }
-      else //make 2 parts from odd side
-      { if (dir=='m')
-        { if ((abs(dxl2)+abs(dyl2))%2==0)
-          { go(x0, y0, dxl2, dyl2, dxr, dyr, 'l');
-            go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'm');
-          }
-          else
-          { go(x0, y0, dxl2, dyl2, dxr, dyr, 'm');
-            go(x0+dxl2+dxr, y0+dyl2+dyr, -dxr, -dyr, dxl-dxl2, dyl-dyl2, 'r');
-          }
-          return;
-        }
-      }
-    }
-    else //right side is odd
-    { if (dir=='l')
-      { go(x0, y0, dxl2, dyl2, dxr, dyr, 'l');
-        go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'l');
-        return;
-      }
-      if (dir=='m')
-      { go(x0, y0, dxl2, dyl2, dxr, dyr, 'l');
-        go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'm');
-        return;
-      }
-    }
-  }
-  if (2*(abs(dxr)+abs(dyr))>3*(abs(dxl)+abs(dyl))) //right side much longer than left side
-  { int dxr2=dxr/2;
-    int dyr2=dyr/2;
-    if ((abs(dxl)+abs(dyl))%2==0) //left side is even
-    { if ((abs(dxr)+abs(dyr))%2==0) //make 2 parts from even side
-      { if (dir=='r')
-        { if ((abs(dxr)+abs(dyr))%4==0) //make 2 parts even-even from even side
-          { go(x0, y0, dxl, dyl, dxr2, dyr2, 'r');
-            go(x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'r');
-          }
-          else //make 2 parts odd-odd from even side
-          { go(x0, y0, dxl, dyl, dxr2, dyr2, 'm');
-            go(x0+dxr2+dxl, y0+dyr2+dyl, dxr-dxr2, dyr-dyr2, -dxl, -dyl, 'm');
-          }
-          return;
-        }
-      }
-      else //make 2 parts from odd side
-      { if (dir=='m')
-        { if ((abs(dxr2)+abs(dyr2))%2==0)
-          { go(x0, y0, dxl, dyl, dxr2, dyr2, 'r');
-            go(x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'm');
-          }
-          else
-          { go(x0, y0, dxl, dyl, dxr2, dyr2, 'm');
-            go(x0+dxr2+dxl, y0+dyr2+dyl, dxr-dxr2, dyr-dyr2, -dxl, -dyl, 'l');
-          }
-          return;
-        }
-      }
-    }
-    else //left side is odd
-    { if (dir=='r')
-      { go(x0, y0, dxl, dyl, dxr2, dyr2, 'r');
-        go(x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'r');
-        return;
-      }
-      if (dir=='m')
-      { go(x0, y0, dxl, dyl, dxr2, dyr2, 'r');
-        go(x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'm');
-        return;
-      }
-    }
-  }
-  //divide into 2x2 parts
-  if ((dir=='l')||(dir=='r'))
-  { int dxl2=dxl/2;
-    int dyl2=dyl/2;
-    int dxr2=dxr/2;
-    int dyr2=dyr/2;
-    if ((abs(dxl+dyl)%2==0)&&(abs(dxr+dyr)%2==0)) //even-even
-    { if (abs(dxl2+dyl2+dxr2+dyr2)%2==0) //ee-ee or oo-oo
-      { if (dir=='l')
-        { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-          go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'l');
-          go(x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'l');
-          go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-        }
-        else
-        { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-          go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'r');
-          go(x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'r');
-          go(x0+dxr+dxl2, y0+dyr+dyl2, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-        }
-      }
-      else //ee-oo or oo-ee
-      { if ((dxr2+dyr2)%2==0) //ee-oo
-        { if (dir=='l')
-          { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-            go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
-            go(x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
-            go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-          }
-          else //ee-oo for dir="r" not possible, so transforming into e-1,e+1-oo = oo-oo
-          { if (dxr2!=0) dxr2++; else dyr2++;
-            go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-            go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
-            go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
-            go(x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-          }
-        }
-        else //oo-ee
-        { if (dir=='r')
-          { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-            go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
-            go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
-            go(x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-          }
-          else //oo-ee for dir="l" not possible, so transforming into oo-e-1,e+1 = oo-oo
-          { if (dxl2!=0) dxl2++; else dyl2++;
-            go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-            go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
-            go(x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
-            go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-          }
-        }
-      }
-    }
-    else //not even-even
-    { if ((abs(dxl+dyl)%2!=0)&&(abs(dxr+dyr)%2!=0)) //odd-odd
-      { if (dxl2%2!=0) dxl2=dxl-dxl2; //get it in a shape eo-eo
-        if (dyl2%2!=0) dyl2=dyl-dyl2;
-        if (dxr2%2!=0) dxr2=dxr-dxr2;
-        if (dyr2%2!=0) dyr2=dyr-dyr2;
-        if (dir=='l')
-        { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-          go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
-          go(x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
-          go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-        }
-        else
-        { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-          go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
-          go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
-          go(x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-        }
-      }
-      else //even-odd or odd-even
-      { if (abs(dxl+dyl)%2==0) //odd-even
-        { if (dir=='l')
-          { if (dxr2%2!=0) dxr2=dxr-dxr2; //get it in a shape eo-xx
-            if (dyr2%2!=0) dyr2=dyr-dyr2;
-            if (abs(dxl+dyl)>2)
-            { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-              go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'l');
-              go(x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'l');
-              go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-            }
-            else
-            { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
-              go(x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
-              go(x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
-              go(x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
-            }
-          }
-          else msg("4-part-error1: %d, %d, %d, %d, %d, %d, %c",x0,y0,dxl,dyl,dxr,dyr,dir);
-        }
-        else //even-odd
-        { if (dir=='r')
-          { if (dxl2%2!=0) dxl2=dxl-dxl2; //get it in a shape xx-eo
-            if (dyl2%2!=0) dyl2=dyl-dyl2;
-            if (abs(dxr+dyr)>2)
-            { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-              go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'r');
-              go(x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'r');
-              go(x0+dxr+dxl2, y0+dyr+dyl2, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-            }
-            else
-            { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
-              go(x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
-              go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
-              go(x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
-            }
-          }
-          else msg("4-part-error2: %d, %d, %d, %d, %d, %d, %c",x0,y0,dxl,dyl,dxr,dyr,dir);
-        }
-      }
-    }
-  }
-  else //dir=="m" -> divide into 3x3 parts
-  { if ((abs(dxl+dyl)%2==0)&&(abs(dxr+dyr)%2==0))
-      msg("9-part-error1: %d, %d, %d, %d, %d, %d, %c",x0,y0,dxl,dyl,dxr,dyr,dir);
-    int dxl2,dyl2,dxr2,dyr2;
-    if (abs(dxr+dyr)%2==0) //even-odd: oeo-ooo
-    { dxl2=dxl/3;
-      dyl2=dyl/3;
-      dxr2=dxr/3;
-      dyr2=dyr/3;
-      if ((dxl2+dyl2)%2==0) //make it odd
-      { dxl2=dxl-2*dxl2;
-        dyl2=dyl-2*dyl2;
-      }
-      if ((dxr2+dyr2)%2==0) //make it odd (not necessary, however results are better for 12x30, 18x30 etc.)
-      { if (abs(dxr2+dyr2)!=2)
-        { if (dxr<0) dxr2++;
-          if (dxr>0) dxr2--;  //dont use else here !
-          if (dyr<0) dyr2++;
-          if (dyr>0) dyr2--;  //dont use else here !
-        }
-      }
-    }
-    else //odd-even: ooo-oeo
-    { dxl2=dxl/3;
-      dyl2=dyl/3;
-      dxr2=dxr/3;
-      dyr2=dyr/3;
-      if ((dxr2+dyr2)%2==0) //make it odd
-      { dxr2=dxr-2*dxr2;
-        dyr2=dyr-2*dyr2;
-      }
-      if ((dxl2+dyl2)%2==0) //make it odd (not necessary, however results are better for 12x30, 18x30 etc.)
-      { if (abs(dxl2+dyl2)!=2)
-        { if (dxl<0) dxl2++;
-          if (dxl>0) dxl2--;  //dont use else here !
-          if (dyl<0) dyl2++;
-          if (dyl>0) dyl2--;  //dont use else here !
-        }
-      }
-    }
-    if (abs(dxl+dyl)<abs(dxr+dyr))
-    { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxl2+dxr2, y0+dyl2+dyr2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
-      go(x0+dxl-dxl2, y0+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
-      go(x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, 2*dxl2-dxl, 2*dyl2-dyl, 2*dxr2-dxr, 2*dyr2-dyr, 'm');
-      go(x0+dxl2+dxr2, y0+dyl2+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
-      go(x0+dxr-dxr2, y0+dyr-dyr2, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxr+dxl2, y0+dyr+dyl2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
-      go(x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
-    }
-    else
-    { go(x0, y0, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxl2+dxr2, y0+dyl2+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
-      go(x0+dxr-dxr2, y0+dyr-dyr2, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxr+dxl2, y0+dyr+dyl2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
-      go(x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, 2*dxl2-dxl, 2*dyl2-dyl, 2*dxr2-dxr, 2*dyr2-dyr, 'm');
-      go(x0+dxl2+dxr2, y0+dyl2+dyr2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
-      go(x0+dxl-dxl2, y0+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
-      go(x0+dxl+dxr2, y0+dyl+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
-      go(x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
-    }
-  }
+int sfc_fill_xy(int ww,int hh, int32_t *xs, int32_t *ys) //curve index -> x, y as two arrays of ww*hh
+{ sfc_point buf[SFC_BATCH];
+  int32_t *xy[2];
+  if ((!xs)||(!ys)) return SFC_EARG;
+  xy[0]=xs; xy[1]=ys;
+  return sfc_fill(ww,hh, buf,SFC_BATCH, flush_xy,xy);
+}
+int sfc_fill_xy16(int ww,int hh, uint16_t *xy) //curve index -> packed x, y pairs, 2*ww*hh entries
+{ sfc_point buf[SFC_BATCH];
+  if ((ww>65536)||(hh>65536)||(!xy)) return SFC_EARG;
+  return sfc_fill(ww,hh, buf,SFC_BATCH, flush_xy16,xy);
+}
+int sfc_fill_inverse(int ww,int hh, uint32_t *idx) //idx[y*ww+x] = curve index of x, y
+{ sfc_point buf[SFC_BATCH];
+  inverse_ctx c;
+  if ((ww<=0)||(hh<=0)||((uint64_t)ww*(uint64_t)hh>(uint64_t)UINT32_MAX+1)||(!idx)) return SFC_EARG;
+  c.idx=idx; c.ww=ww;
+  return sfc_fill(ww,hh, buf,SFC_BATCH, flush_inverse,&c);
 }
 
+#ifndef DRAW_SFC_NO_MAIN
 
 typedef struct fill_ctx {
   size_t render_count;
+  int32_t *xs, *ys;
 } *fill_ctx_p, fill_ctx;
 
 void render_cb(int x, int y, fill_ctx_p ctx) {
+  if (ctx->xs) {
+    ctx->xs[ctx->render_count] = x;
+    ctx->ys[ctx->render_count] = y;
+  }
   ctx->render_count += 1;
 }
 
+//bulk fills must give the same cells as the callback
+static int check_bulk(int w, int h) {
+  size_t n = (size_t)w*h, i;
+  int ok = 1;
+  fill_ctx ctx = {0, malloc(n*sizeof(int32_t)), malloc(n*sizeof(int32_t))};
+  int32_t *xs = malloc(n*sizeof(int32_t)), *ys = malloc(n*sizeof(int32_t));
+  uint16_t *xy = malloc(2*n*sizeof(uint16_t));
+  uint32_t *idx = malloc(n*sizeof(uint32_t));
+
+  spacefill(w,h, (RenderCallback) render_cb, &ctx);
+  sfc_fill_xy(w,h, xs, ys);
+  sfc_fill_xy16(w,h, xy);
+  sfc_fill_inverse(w,h, idx);
+  for (i=0; i<n; i++)
+    if (xs[i]!=ctx.xs[i] || ys[i]!=ctx.ys[i] || xy[2*i]!=xs[i] || xy[2*i+1]!=ys[i] || idx[(size_t)ys[i]*w+xs[i]]!=i)
+    { ok = 0; break; }
+  free(ctx.xs); free(ctx.ys); free(xs); free(ys); free(xy); free(idx);
+  return ok;
+}
+
 
 int main() {
 
-  fill_ctx ctx;
+  fill_ctx ctx = {0};
 
   for (int x=1; x<=3333; x++)
   for (int y=1; y<=33; y++) {
@@ -388,8 +116,20 @@ int main() {
     spacefill(x,y, (RenderCallback) render_cb, &ctx);
     if (ctx.render_count != x*y) {
       printf("%d,%d fail!\n",x,y);
+    }
+    if (x<=333 && !check_bulk(x,y)) {
+      printf("%d,%d bulk fail!\n",x,y);
     }
       printf("\r                     \r%.2f%%",x * 100.0/3333);
   }
 
+  //ww*hh past INT_MAX, the largest size sfc_fill_xy16 and sfc_fill_inverse accept
+  ctx.render_count = 0;
+  spacefill(65536,65536, (RenderCallback) render_cb, &ctx);
+  if (ctx.render_count != (size_t)65536*65536) {
+    printf("\n65536,65536 fail!\n");
+  }
+
 }
+
+#endif
@@ -0,0 +1,36 @@
+/*
+A 2D algorithm that combines Peano (3x3) and Hilbert (2x2) blocks was published by Lutz Tautenhahn in 2003:
+
+[1] Lutz Tautenhahn: Draw a Space-Filling Curve of Arbitrary Size, http://lutanho.net/pic2html/draw_sfc.html, 2003.
+
+Plain C interface of draw_sfc.c, usable through FFI (ctypes/cffi, Rust extern "C").
+Build draw_sfc.c with -DDRAW_SFC_NO_MAIN to use it as a library. C code can include the
+header-only core draw_sfc_core.h directly instead.
+*/
+#ifndef DRAW_SFC_H
+#define DRAW_SFC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*RenderCallback)(int x, int y, void * ctx);
+
+//calls cb(x, y, ctx) for every cell of the ww x hh grid in curve order
+void spacefill(int ww, int hh, RenderCallback cb, void *ctx);
+
+//bulk fills without a per-cell callback, all return 0 (SFC_OK) on success and -1 (SFC_EARG) on bad arguments
+//xs[i], ys[i]: cell number i of the curve, both arrays hold ww*hh entries
+int sfc_fill_xy(int ww, int hh, int32_t *xs, int32_t *ys);
+//xy[2*i], xy[2*i+1]: cell number i of the curve, 2*ww*hh entries, ww and hh up to 65536
+int sfc_fill_xy16(int ww, int hh, uint16_t *xy);
+//idx[y*ww+x]: curve index of the cell x, y, ww*hh entries, ww*hh up to 2^32
+int sfc_fill_inverse(int ww, int hh, uint32_t *idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,437 @@
+/*
+A 2D algorithm that combines Peano (3x3) and Hilbert (2x2) blocks was published by Lutz Tautenhahn in 2003:
+
+[1] Lutz Tautenhahn: Draw a Space-Filling Curve of Arbitrary Size, http://lutanho.net/pic2html/draw_sfc.html, 2003.
+
+Header-only C99 core of draw_sfc.c. All state lives in an sfc_state on the caller's stack, so
+fills are reentrant and can run on any number of threads at once. Cells are written as
+sfc_point into a caller-supplied buffer, one whole leaf of the split at a time; when the
+next leaf does not fit, the buffer is handed to flush(pts, n, first, ctx) with the 64-bit
+curve index of pts[0] and reused.
+
+  sfc_point buf[4096];
+  int err = sfc_fill(ww, hh, buf, 4096, consume, ctx); //SFC_OK or a negative SFC_E* code
+
+The buffer must hold at least min(6, ww*hh) cells, the largest leaf. Without flush it must
+hold all ww*hh cells, and the curve is left in it. ww and hh go up to SFC_MAX_SIDE, the
+recursion works with 3 times a side in int; cell counts and indices are 64-bit.
+*/
+#ifndef DRAW_SFC_CORE_H
+#define DRAW_SFC_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sfc_point { int32_t x, y; } sfc_point;
+
+#define SFC_MAX_SIDE (1<<29)
+
+enum
+{ SFC_OK=0,
+  SFC_EARG=-1,      //bad size, no buffer, or a buffer too small for one leaf
+  SFC_EOVERFLOW=-2, //no flush and the buffer holds less than ww*hh cells
+  SFC_EABORT=-3,    //flush returned nonzero
+  SFC_ESPLIT=-4     //a node the split cannot handle, never seen for valid sizes
+};
+
+//return nonzero to stop the fill
+typedef int (*sfc_flush_fn)(const sfc_point *pts, size_t n, uint64_t first, void *ctx);
+
+typedef struct sfc_state {
+  sfc_point *buf;
+  size_t cap, len;   //buffer capacity and cells in it
+  uint64_t first;    //curve index of buf[0]
+  sfc_flush_fn flush;
+  void *ctx;
+  int err;
+} sfc_state;
+
+//hand the buffer to flush, SFC_OK or the error to stop with
+static inline int sfc_flush(sfc_state *s)
+{ if (s->len && s->flush && s->flush(s->buf, s->len, s->first, s->ctx)) return SFC_EABORT;
+  s->first+=s->len;
+  s->len=0;
+  return SFC_OK;
+}
+
+//make room for a leaf of n cells, 0 (with s->err set) if the fill must stop
+static inline int sfc__reserve(sfc_state *s, size_t n)
+{ if (s->len+n<=s->cap) return 1;
+  if (!s->flush) s->err=SFC_EOVERFLOW;
+  else s->err=sfc_flush(s);
+  return !s->err;
+}
+
+static inline void sfc__put(sfc_state *s, int x, int y)
+{ sfc_point *p=s->buf+s->len++;
+  p->x=x; p->y=y;
+}
+
+static inline void sfc__go(sfc_state *s, int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir)
+{ if (s->err) return; //x0, y0: start corner looking to the center of the rectangle
+  //dxl, dyl: vector from the start corner to the left corner of the rectangle
+  //dxr, dyr: vector from the start corner to the right corner of the rectangle
+  //dir: direction to go - "l"=left, "m"=middle, "r"=right
+  //render if 2x3 or smaller
+  int64_t cells=(int64_t)abs(dxl+dyl)*abs(dxr+dyr); //64-bit, ww*hh can pass INT_MAX
+  if (cells<=6)
+  { int ddx, ddy, ii;
+    if (!sfc__reserve(s, (size_t)cells)) return;
+    if (abs(dxl+dyl)==1)
+    { ddx=dxr/abs(dxr+dyr);
+      ddy=dyr/abs(dxr+dyr);
+      for (ii=0; ii<abs(dxr+dyr); ii++)
+        sfc__put(s, x0+ii*ddx+(dxl+ddx-1)/2, y0+ii*ddy+(dyl+ddy-1)/2);
+      return;
+    }
+    if (abs(dxr+dyr)==1)
+    { ddx=dxl/abs(dxl+dyl);
+      ddy=dyl/abs(dxl+dyl);
+      for (ii=0; ii<abs(dxl+dyl); ii++)
+        sfc__put(s, x0+ii*ddx+(dxr+ddx-1)/2, y0+ii*ddy+(dyr+ddy-1)/2);
+      return;
+    }
+    if (dir=='l')
+    { ddx=dxr/abs(dxr+dyr);
+      ddy=dyr/abs(dxr+dyr);
+      for (ii=0; ii<abs(dxr+dyr); ii++)
+        sfc__put(s, x0+ii*ddx+(dxl/2+ddx-1)/2, y0+ii*ddy+(dyl/2+ddy-1)/2);
+      for (ii=abs(dxr+dyr)-1; ii>=0; ii--)
+        sfc__put(s, x0+ii*ddx+(dxl+dxl/2+ddx-1)/2, y0+ii*ddy+(dyl+dyl/2+ddy-1)/2);
+      return;
+    }
+    if (dir=='r')
+    { ddx=dxl/abs(dxl+dyl);
+      ddy=dyl/abs(dxl+dyl);
+      for (ii=0; ii<abs(dxl+dyl); ii++)
+        sfc__put(s, x0+ii*ddx+(dxr/2+ddx-1)/2, y0+ii*ddy+(dyr/2+ddy-1)/2);
+      for (ii=abs(dxl+dyl)-1; ii>=0; ii--)
+        sfc__put(s, x0+ii*ddx+(dxr+dxr/2+ddx-1)/2, y0+ii*ddy+(dyr+dyr/2+ddy-1)/2);
+      return;
+    }
+    if (dir=='m')
+    { if (abs(dxr+dyr)==3)
+      { ddx=dxr/abs(dxr+dyr);
+        ddy=dyr/abs(dxr+dyr);
+        sfc__put(s, x0+(dxl/2+ddx-1)/2, y0+(dyl/2+ddy-1)/2);
+        sfc__put(s, x0+(dxl+dxl/2+ddx-1)/2, y0+(dyl+dyl/2+ddy-1)/2);
+        sfc__put(s, x0+ddx+(dxl+dxl/2+ddx-1)/2, y0+ddy+(dyl+dyl/2+ddy-1)/2);
+        sfc__put(s, x0+ddx+(dxl/2+ddx-1)/2, y0+ddy+(dyl/2+ddy-1)/2);
+        sfc__put(s, x0+2*ddx+(dxl/2+ddx-1)/2, y0+2*ddy+(dyl/2+ddy-1)/2);
+        sfc__put(s, x0+2*ddx+(dxl+dxl/2+ddx-1)/2, y0+2*ddy+(dyl+dyl/2+ddy-1)/2);
+        return;
+      }
+      if (abs(dxl+dyl)==3)
+      { ddx=dxl/abs(dxl+dyl);
+        ddy=dyl/abs(dxl+dyl);
+        sfc__put(s, x0+(dxr/2+ddx-1)/2, y0+(dyr/2+ddy-1)/2);
+        sfc__put(s, x0+(dxr+dxr/2+ddx-1)/2, y0+(dyr+dyr/2+ddy-1)/2);
+        sfc__put(s, x0+ddx+(dxr+dxr/2+ddx-1)/2, y0+ddy+(dyr+dyr/2+ddy-1)/2);
+        sfc__put(s, x0+ddx+(dxr/2+ddx-1)/2, y0+ddy+(dyr/2+ddy-1)/2);
+        sfc__put(s, x0+2*ddx+(dxr/2+ddx-1)/2, y0+2*ddy+(dyr/2+ddy-1)/2);
+        sfc__put(s, x0+2*ddx+(dxr+dxr/2+ddx-1)/2, y0+2*ddy+(dyr+dyr/2+ddy-1)/2);
+        return;
+      }
+    }
+    s->err=SFC_ESPLIT; //no leaf pattern
+    return;
+  }
+  //divide into 2 parts if necessary
+  if (2*(abs(dxl)+abs(dyl))>3*(abs(dxr)+abs(dyr))) //left side much longer than right side
+  { int dxl2=dxl/2;
+    int dyl2=dyl/2;
+    if ((abs(dxr)+abs(dyr))%2==0) //right side is even
+    { if ((abs(dxl)+abs(dyl))%2==0) //make 2 parts from even side
+      { if (dir=='l')
+        { if ((abs(dxl)+abs(dyl))%4==0) //make 2 parts even-even from even side
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'l');
+            sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'l');
+          }
+          else //make 2 parts odd-odd from even side
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'm');
+            sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxr, -dyr, dxl-dxl2, dyl-dyl2, 'm');
+          }
+          return;
+        }
+      }
+      else //make 2 parts from odd side
+      { if (dir=='m')
+        { if ((abs(dxl2)+abs(dyl2))%2==0)
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'l');
+            sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'm');
+          }
+          else
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'm');
+            sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxr, -dyr, dxl-dxl2, dyl-dyl2, 'r');
+          }
+          return;
+        }
+      }
+    }
+    else //right side is odd
+    { if (dir=='l')
+      { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'l');
+        sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'l');
+        return;
+      }
+      if (dir=='m')
+      { sfc__go(s, x0, y0, dxl2, dyl2, dxr, dyr, 'l');
+        sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr, dyr, 'm');
+        return;
+      }
+    }
+  }
+  if (2*(abs(dxr)+abs(dyr))>3*(abs(dxl)+abs(dyl))) //right side much longer than left side
+  { int dxr2=dxr/2;
+    int dyr2=dyr/2;
+    if ((abs(dxl)+abs(dyl))%2==0) //left side is even
+    { if ((abs(dxr)+abs(dyr))%2==0) //make 2 parts from even side
+      { if (dir=='r')
+        { if ((abs(dxr)+abs(dyr))%4==0) //make 2 parts even-even from even side
+          { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'r');
+            sfc__go(s, x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'r');
+          }
+          else //make 2 parts odd-odd from even side
+          { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'm');
+            sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxr-dxr2, dyr-dyr2, -dxl, -dyl, 'm');
+          }
+          return;
+        }
+      }
+      else //make 2 parts from odd side
+      { if (dir=='m')
+        { if ((abs(dxr2)+abs(dyr2))%2==0)
+          { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'r');
+            sfc__go(s, x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'm');
+          }
+          else
+          { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'm');
+            sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxr-dxr2, dyr-dyr2, -dxl, -dyl, 'l');
+          }
+          return;
+        }
+      }
+    }
+    else //left side is odd
+    { if (dir=='r')
+      { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'r');
+        sfc__go(s, x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'r');
+        return;
+      }
+      if (dir=='m')
+      { sfc__go(s, x0, y0, dxl, dyl, dxr2, dyr2, 'r');
+        sfc__go(s, x0+dxr2, y0+dyr2, dxl, dyl, dxr-dxr2, dyr-dyr2, 'm');
+        return;
+      }
+    }
+  }
+  //divide into 2x2 parts
+  if ((dir=='l')||(dir=='r'))
+  { int dxl2=dxl/2;
+    int dyl2=dyl/2;
+    int dxr2=dxr/2;
+    int dyr2=dyr/2;
+    if ((abs(dxl+dyl)%2==0)&&(abs(dxr+dyr)%2==0)) //even-even
+    { if (abs(dxl2+dyl2+dxr2+dyr2)%2==0) //ee-ee or oo-oo
+      { if (dir=='l')
+        { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+          sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'l');
+          sfc__go(s, x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'l');
+          sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+        }
+        else
+        { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+          sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'r');
+          sfc__go(s, x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'r');
+          sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+        }
+      }
+      else //ee-oo or oo-ee
+      { if ((dxr2+dyr2)%2==0) //ee-oo
+        { if (dir=='l')
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+            sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
+            sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
+            sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+          }
+          else //ee-oo for dir="r" not possible, so transforming into e-1,e+1-oo = oo-oo
+          { if (dxr2!=0) dxr2++; else dyr2++;
+            sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+            sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
+            sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
+            sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+          }
+        }
+        else //oo-ee
+        { if (dir=='r')
+          { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+            sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
+            sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
+            sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+          }
+          else //oo-ee for dir="l" not possible, so transforming into oo-e-1,e+1 = oo-oo
+          { if (dxl2!=0) dxl2++; else dyl2++;
+            sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+            sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
+            sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
+            sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+          }
+        }
+      }
+    }
+    else //not even-even
+    { if ((abs(dxl+dyl)%2!=0)&&(abs(dxr+dyr)%2!=0)) //odd-odd
+      { if (dxl2%2!=0) dxl2=dxl-dxl2; //get it in a shape eo-eo
+        if (dyl2%2!=0) dyl2=dyl-dyl2;
+        if (dxr2%2!=0) dxr2=dxr-dxr2;
+        if (dyr2%2!=0) dyr2=dyr-dyr2;
+        if (dir=='l')
+        { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+          sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
+          sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
+          sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+        }
+        else
+        { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+          sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
+          sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
+          sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+        }
+      }
+      else //even-odd or odd-even
+      { if (abs(dxl+dyl)%2==0) //odd-even
+        { if (dir=='l')
+          { if (dxr2%2!=0) dxr2=dxr-dxr2; //get it in a shape eo-xx
+            if (dyr2%2!=0) dyr2=dyr-dyr2;
+            if (abs(dxl+dyl)>2)
+            { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+              sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'l');
+              sfc__go(s, x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'l');
+              sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+            }
+            else
+            { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'r');
+              sfc__go(s, x0+dxr2, y0+dyr2, dxl2, dyl2, dxr-dxr2, dyr-dyr2, 'm');
+              sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, dxr2-dxr, dyr2-dyr, dxl-dxl2, dyl-dyl2, 'm');
+              sfc__go(s, x0+dxr2+dxl, y0+dyr2+dyl, dxl2-dxl, dyl2-dyl, -dxr2, -dyr2, 'r');
+            }
+          }
+          else s->err=SFC_ESPLIT;
+        }
+        else //even-odd
+        { if (dir=='r')
+          { if (dxl2%2!=0) dxl2=dxl-dxl2; //get it in a shape xx-eo
+            if (dyl2%2!=0) dyl2=dyl-dyl2;
+            if (abs(dxr+dyr)>2)
+            { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+              sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'r');
+              sfc__go(s, x0+dxr2+dxl2, y0+dyr2+dyl2, dxl-dxl2, dyl-dyl2, dxr-dxr2, dyr-dyr2, 'r');
+              sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+            }
+            else
+            { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'l');
+              sfc__go(s, x0+dxl2, y0+dyl2, dxl-dxl2, dyl-dyl2, dxr2, dyr2, 'm');
+              sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-dxr2, dyr-dyr2, dxl2-dxl, dyl2-dyl, 'm');
+              sfc__go(s, x0+dxl2+dxr, y0+dyl2+dyr, -dxl2, -dyl2, dxr2-dxr, dyr2-dyr, 'l');
+            }
+          }
+          else s->err=SFC_ESPLIT;
+        }
+      }
+    }
+  }
+  else //dir=="m" -> divide into 3x3 parts
+  { if ((abs(dxl+dyl)%2==0)&&(abs(dxr+dyr)%2==0))
+      { s->err=SFC_ESPLIT; return; }
+    int dxl2,dyl2,dxr2,dyr2;
+    if (abs(dxr+dyr)%2==0) //even-odd: oeo-ooo
+    { dxl2=dxl/3;
+      dyl2=dyl/3;
+      dxr2=dxr/3;
+      dyr2=dyr/3;
+      if ((dxl2+dyl2)%2==0) //make it odd
+      { dxl2=dxl-2*dxl2;
+        dyl2=dyl-2*dyl2;
+      }
+      if ((dxr2+dyr2)%2==0) //make it odd (not necessary, however results are better for 12x30, 18x30 etc.)
+      { if (abs(dxr2+dyr2)!=2)
+        { if (dxr<0) dxr2++;
+          if (dxr>0) dxr2--;  //dont use else here !
+          if (dyr<0) dyr2++;
+          if (dyr>0) dyr2--;  //dont use else here !
+        }
+      }
+    }
+    else //odd-even: ooo-oeo
+    { dxl2=dxl/3;
+      dyl2=dyl/3;
+      dxr2=dxr/3;
+      dyr2=dyr/3;
+      if ((dxr2+dyr2)%2==0) //make it odd
+      { dxr2=dxr-2*dxr2;
+        dyr2=dyr-2*dyr2;
+      }
+      if ((dxl2+dyl2)%2==0) //make it odd (not necessary, however results are better for 12x30, 18x30 etc.)
+      { if (abs(dxl2+dyl2)!=2)
+        { if (dxl<0) dxl2++;
+          if (dxl>0) dxl2--;  //dont use else here !
+          if (dyl<0) dyl2++;
+          if (dyl>0) dyl2--;  //dont use else here !
+        }
+      }
+    }
+    if (abs(dxl+dyl)<abs(dxr+dyr))
+    { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxl2+dxr2, y0+dyl2+dyr2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
+      sfc__go(s, x0+dxl-dxl2, y0+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, 2*dxl2-dxl, 2*dyl2-dyl, 2*dxr2-dxr, 2*dyr2-dyr, 'm');
+      sfc__go(s, x0+dxl2+dxr2, y0+dyl2+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2, y0+dyr-dyr2, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
+    }
+    else
+    { sfc__go(s, x0, y0, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxl2+dxr2, y0+dyl2+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2, y0+dyr-dyr2, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxr+dxl2, y0+dyr+dyl2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, 2*dxl2-dxl, 2*dyl2-dyl, 2*dxr2-dxr, 2*dyr2-dyr, 'm');
+      sfc__go(s, x0+dxl2+dxr2, y0+dyl2+dyr2, -dxr2, -dyr2, dxl-2*dxl2, dyl-2*dyl2, 'm');
+      sfc__go(s, x0+dxl-dxl2, y0+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
+      sfc__go(s, x0+dxl+dxr2, y0+dyl+dyr2, dxr-2*dxr2, dyr-2*dyr2, -dxl2, -dyl2, 'm');
+      sfc__go(s, x0+dxr-dxr2+dxl-dxl2, y0+dyr-dyr2+dyl-dyl2, dxl2, dyl2, dxr2, dyr2, 'm');
+    }
+  }
+}
+
+//fills ww x hh in curve order, see above; the last cells are flushed before it returns
+static inline int sfc_fill(int ww, int hh, sfc_point *buf, size_t cap, sfc_flush_fn flush, void *ctx)
+{ sfc_state st;
+  sfc_state *s=&st;
+  if ((ww<=0)||(hh<=0)||(ww>SFC_MAX_SIDE)||(hh>SFC_MAX_SIDE)||(!buf)) return SFC_EARG;
+  if ((cap<6)&&((uint64_t)cap<(uint64_t)ww*(uint64_t)hh)) return SFC_EARG; //no room for a leaf
+  st.buf=buf; st.cap=cap; st.len=0; st.first=0;
+  st.flush=flush; st.ctx=ctx; st.err=SFC_OK;
+  if (hh>ww) //go top->down
+  { if ((hh%2==1)&&(ww%2==0)) sfc__go(s, 0, 0, ww, 0, 0, hh, 'm'); //go diagonal
+    else sfc__go(s, 0, 0, ww, 0, 0, hh, 'r'); //go top->down
+  }
+  else //go left->right
+  { if ((ww%2==1)&&(hh%2==0)) sfc__go(s, 0, 0, ww, 0, 0, hh, 'm'); //go diagonal
+    else sfc__go(s, 0, 0, ww, 0, 0, hh, 'l'); //go left->right
+  }
+  if ((!st.err)&&(flush)) st.err=sfc_flush(s);
+  return st.err;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,21 +8,149 @@ http://lutanho.net/pic2html/draw_sfc.html, 2003.
 */
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace hilbert_piano {
+struct point {
+  int x, y;
+};
+
+// axis aligned rectangle of cells
+struct rect {
+  int x, y, w, h;
+};
+
+// cells of the rectangle spanned by a go() node
+inline rect node_rect(int x0, int y0, int dxl, int dyl, int dxr, int dyr) {
+  int xa = x0 + (dxl < 0 ? dxl : 0) + (dxr < 0 ? dxr : 0);
+  int ya = y0 + (dyl < 0 ? dyl : 0) + (dyr < 0 ? dyr : 0);
+  return rect{xa, ya, abs(dxl + dxr), abs(dyl + dyr)};
+}
+
+// number of cells (= curve indices) covered by a go() node
+inline std::int64_t node_cells(int dxl, int dyl, int dxr, int dyr) {
+  return (std::int64_t)abs(dxl + dyl) * abs(dxr + dyr);
+}
+
+namespace detail {
+// optional node hooks of a render callback object:
+//   bool enter(x0, y0, dxl, dyl, dxr, dyr, dir) - false skips the whole node
+//   void leave(x0, y0, dxl, dyl, dxr, dyr, dir) - after the node is rendered
+template <typename R>
+inline auto node_enter(R &render, int x0, int y0, int dxl, int dyl, int dxr,
+                       int dyr, char dir, int)
+    -> decltype(bool(render.enter(x0, y0, dxl, dyl, dxr, dyr, dir))) {
+  return render.enter(x0, y0, dxl, dyl, dxr, dyr, dir);
+}
+template <typename R>
+inline bool node_enter(R &, int, int, int, int, int, int, char, long) {
+  return true;
+}
+template <typename R>
+inline auto node_leave(R &render, int x0, int y0, int dxl, int dyl, int dxr,
+                       int dyr, char dir, int)
+    -> decltype(render.leave(x0, y0, dxl, dyl, dxr, dyr, dir), void()) {
+  render.leave(x0, y0, dxl, dyl, dxr, dyr, dir);
+}
+template <typename R>
+inline void node_leave(R &, int, int, int, int, int, int, char, long) {}
+
+template <typename R>
+auto has_enter(int) -> decltype(std::declval<R &>().enter(0, 0, 0, 0, 0, 0, 'l'),
+                                std::true_type());
+template <typename R> std::false_type has_enter(long);
+template <typename R>
+auto has_leave(int) -> decltype(std::declval<R &>().leave(0, 0, 0, 0, 0, 0, 'l'),
+                                std::true_type());
+template <typename R> std::false_type has_leave(long);
+template <typename R>
+struct has_node_hooks
+    : std::integral_constant<bool, decltype(has_enter<R>(0))::value ||
+                                       decltype(has_leave<R>(0))::value> {};
+
+// A square node of side 2^k with dir 'l' or 'r' only ever takes the even-even
+// 2x2 branch of go_node(), which builds a plain Hilbert curve. Its cells are
+// generated here with a 4-state machine over 2 index bits per level instead of
+// the recursion. In the frame of the node, hx runs along the side the curve
+// ends on (l for 'l', r for 'r'), the curve goes from (0,0) to (n-1,0).
+
+// quadrant (x | y << 1) and next state for index digit q in state s
+static const unsigned char hilbert_quadrant[4][4] = {
+    {0, 2, 3, 1}, {0, 1, 3, 2}, {3, 2, 0, 1}, {3, 1, 0, 2}};
+static const unsigned char hilbert_next[4][4] = {
+    {1, 0, 0, 2}, {0, 1, 1, 3}, {3, 2, 2, 0}, {2, 3, 3, 1}};
+// the 16 cells of a 4x4 block per state: x | y << 2 | flip << 4, where flip
+// marks 2x2 leaves rendered with the other dir than the node
+static const unsigned char hilbert_4x4[4][16] = {
+    {0x10, 0x11, 0x15, 0x14, 0x08, 0x0c, 0x0d, 0x09, 0x0a, 0x0e, 0x0f, 0x0b,
+     0x17, 0x16, 0x12, 0x13},
+    {0x00, 0x04, 0x05, 0x01, 0x12, 0x13, 0x17, 0x16, 0x1a, 0x1b, 0x1f, 0x1e,
+     0x0d, 0x09, 0x08, 0x0c},
+    {0x0f, 0x0b, 0x0a, 0x0e, 0x1d, 0x1c, 0x18, 0x19, 0x15, 0x14, 0x10, 0x11,
+     0x02, 0x06, 0x07, 0x03},
+    {0x1f, 0x1e, 0x1a, 0x1b, 0x07, 0x03, 0x02, 0x06, 0x05, 0x01, 0x00, 0x04,
+     0x18, 0x19, 0x1d, 0x1c}};
+
+// k if the node is a 2^k x 2^k square, 0 otherwise
+inline int hilbert_levels(int dxl, int dyl, int dxr, int dyr) {
+  int side = abs(dxl + dyl);
+  if (side != abs(dxr + dyr) || (side & (side - 1)) != 0)
+    return 0;
+  int levels = 0;
+  while ((1 << levels) < side)
+    levels++;
+  return levels;
+}
+
+template <typename RenderCallback>
+inline void go_hilbert(int x0, int y0, int dxl, int dyl, int dxr, int dyr,
+                       char dir, int levels, RenderCallback &render) {
+  int n = 1 << levels;
+  int ax = (dir == 'l' ? dxl : dxr) / n, ay = (dir == 'l' ? dyl : dyr) / n;
+  int bx = (dir == 'l' ? dxr : dxl) / n, by = (dir == 'l' ? dyr : dyl) / n;
+  char other = dir == 'l' ? 'r' : 'l';
+  x0 += dxl + dxr < 0 ? -1 : 0; // cell left of / above a negative edge
+  y0 += dyl + dyr < 0 ? -1 : 0;
+  std::int64_t blocks = (std::int64_t)1 << (2 * (levels - 2));
+  for (std::int64_t b = 0; b < blocks; b++) {
+    int state = 0, hx = 0, hy = 0;
+    for (int level = levels - 1; level >= 2; level--) {
+      int q = (b >> (2 * (level - 2))) & 3;
+      int p = hilbert_quadrant[state][q];
+      hx |= (p & 1) << level;
+      hy |= (p >> 1) << level;
+      state = hilbert_next[state][q];
+    }
+    for (int i = 0; i < 16; i++) {
+      int p = hilbert_4x4[state][i];
+      int cx = hx + (p & 3), cy = hy + ((p >> 2) & 3);
+      render(x0 + cx * ax + cy * bx, y0 + cx * ay + cy * by,
+             p & 0x10 ? other : dir);
+    }
+  }
+}
+} // namespace detail
+
 template <typename RenderCallback, typename Message>
 inline void go(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir,
-               RenderCallback &&render,
-               Message &&msg) { // x0, y0: start corner looking to the center of
-                                // the rectangle
+               RenderCallback &&render, Message &&msg);
+
+template <typename RenderCallback, typename Message>
+inline void go_node(int x0, int y0, int dxl, int dyl, int dxr, int dyr,
+                    char dir, RenderCallback &&render,
+                    Message &&msg) { // x0, y0: start corner looking to the
+                                     // center of the rectangle
   // dxl, dyl: vector from the start corner to the left corner of the rectangle
   // dxr, dyr: vector from the start corner to the right corner of the rectangle
   // dir: direction to go - "l"=left, "m"=middle, "r"=right
   // msg("go: "+x0+", "+y0+", "+dxl+", "+dyl+", "+dxr+", "+dyr+", "+dir);
   // render if 2x3 or smaller
 
-  if (abs((dxl + dyl) * (dxr + dyr)) <= 6) {
+  if (node_cells(dxl, dyl, dxr, dyr) <= 6) { // 64-bit, ww * hh can pass INT_MAX
     int ddx, ddy, ii;
     if (abs(dxl + dyl) == 1) {
       ddx = dxr / abs(dxr + dyr);
@@ -603,6 +731,25 @@ inline void go(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir,
   }
 }
 
+template <typename RenderCallback, typename Message>
+inline void go(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir,
+               RenderCallback &&render, Message &&msg) {
+  if (!detail::node_enter(render, x0, y0, dxl, dyl, dxr, dyr, dir, 0))
+    return;
+  // Hilbert fast path, not with node hooks as it skips the inner nodes
+  if (!detail::has_node_hooks<RenderCallback>::value &&
+      (dir == 'l' || dir == 'r')) {
+    int levels = detail::hilbert_levels(dxl, dyl, dxr, dyr);
+    if (levels >= 2) {
+      detail::go_hilbert(x0, y0, dxl, dyl, dxr, dyr, dir, levels, render);
+      return;
+    }
+  }
+  go_node(x0, y0, dxl, dyl, dxr, dyr, dir,
+          std::forward<RenderCallback>(render), std::forward<Message>(msg));
+  detail::node_leave(render, x0, y0, dxl, dyl, dxr, dyr, dir, 0);
+}
+
 template <typename RenderCallback>
 void spacefill(
     int ww, int hh,
@@ -623,5 +770,189 @@ void spacefill(
       go(0, 0, ww, 0, 0, hh, 'l', std::forward<RenderCallback>(render), msg); // go left->right
   }
 }
+
+// cells with curve index in [begin, end) only, render(x, y, index); nodes
+// outside the range are skipped whole, so a slice costs O(end - begin) plus
+// the depth of the split tree
+template <typename RenderCallback>
+void spacefill_range(int ww, int hh, std::int64_t begin, std::int64_t end,
+                     RenderCallback &&render) {
+  struct range_render {
+    std::int64_t begin, end, index;
+    RenderCallback &render;
+    bool enter(int, int, int dxl, int dyl, int dxr, int dyr, char) {
+      std::int64_t n = node_cells(dxl, dyl, dxr, dyr);
+      if (index + n <= begin || index >= end) {
+        index += n;
+        return false;
+      }
+      return true;
+    }
+    void operator()(int x, int y, char) {
+      if (index >= begin && index < end)
+        render(x, y, index);
+      index++;
+    }
+  } r{begin, end, 0, render};
+  spacefill(ww, hh, r);
+}
+
+// cells inside the viewport only, render(x, y, index) with the global curve
+// index; nodes that miss the viewport are skipped whole
+template <typename RenderCallback>
+void spacefill_clip(int ww, int hh, rect viewport, RenderCallback &&render) {
+  struct clip_render {
+    rect v;
+    std::int64_t index;
+    RenderCallback &render;
+    bool enter(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char) {
+      rect r = node_rect(x0, y0, dxl, dyl, dxr, dyr);
+      if (r.x >= v.x + v.w || r.x + r.w <= v.x || r.y >= v.y + v.h ||
+          r.y + r.h <= v.y) {
+        index += (std::int64_t)r.w * r.h;
+        return false;
+      }
+      return true;
+    }
+    void operator()(int x, int y, char) {
+      if (x >= v.x && x < v.x + v.w && y >= v.y && y < v.y + v.h)
+        render(x, y, index);
+      index++;
+    }
+  } r{viewport, 0, render};
+  spacefill(ww, hh, r);
+}
+
+// occupancy mask of a grid with a summed-area table, so the number of
+// occupied cells of any rectangle is known in O(1); the mask (nonzero =
+// occupied, row-major with stride bytes per row) must outlive the object,
+// grids up to 2^32-1 cells
+class occupancy {
+public:
+  occupancy(int ww, int hh, const unsigned char *mask, std::size_t stride)
+      : ww(ww), hh(hh), mask(mask), stride(stride),
+        sat((std::size_t)(ww + 1) * (hh + 1)) {
+    for (int y = 0; y < hh; y++) {
+      std::uint32_t row = 0;
+      for (int x = 0; x < ww; x++) {
+        row += mask[y * stride + x] != 0;
+        at(x + 1, y + 1) = at(x + 1, y) + row;
+      }
+    }
+  }
+  std::uint32_t count(rect r) const {
+    return at(r.x + r.w, r.y + r.h) - at(r.x, r.y + r.h) -
+           at(r.x + r.w, r.y) + at(r.x, r.y);
+  }
+  std::uint32_t count() const { return at(ww, hh); }
+  bool operator()(int x, int y) const { return mask[y * stride + x] != 0; }
+  int width() const { return ww; }
+  int height() const { return hh; }
+
+private:
+  std::uint32_t &at(int x, int y) { return sat[(std::size_t)y * (ww + 1) + x]; }
+  std::uint32_t at(int x, int y) const {
+    return sat[(std::size_t)y * (ww + 1) + x];
+  }
+  int ww, hh;
+  const unsigned char *mask;
+  std::size_t stride;
+  std::vector<std::uint32_t> sat;
+};
+
+// occupied cells only, in curve order: render(x, y, index, rank) with the
+// global curve index and the compact index among the occupied cells; nodes
+// without occupied cells are skipped whole. This pays off for clustered
+// masks (regions, sparse tiles); on a scattered mask few nodes are empty, so
+// nodes of at most 1024 cells and fully occupied nodes are walked
+// without further table queries, with the Hilbert fast path, and the cost
+// stays close to spacefill() with a mask test per cell.
+template <typename RenderCallback>
+void spacefill_masked(const occupancy &occ, RenderCallback &&render) {
+  struct masked_render {
+    const occupancy &occ;
+    std::int64_t index, rank;
+    RenderCallback &render;
+    bool enter(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char dir) {
+      rect r = node_rect(x0, y0, dxl, dyl, dxr, dyr);
+      std::int64_t area = (std::int64_t)r.w * r.h;
+      std::int64_t n = occ.count(r);
+      if (n == 0) {
+        index += area;
+        return false;
+      }
+      auto msg = [](auto...) {};
+      if (n == area) {
+        go(x0, y0, dxl, dyl, dxr, dyr, dir,
+           [&](int x, int y, char) { render(x, y, index++, rank++); }, msg);
+        return false;
+      }
+      if (area <= 1024) { // small node
+        go(x0, y0, dxl, dyl, dxr, dyr, dir,
+           [&](int x, int y, char) { (*this)(x, y, 0); }, msg);
+        return false;
+      }
+      return true;
+    }
+    void operator()(int x, int y, char) {
+      if (occ(x, y))
+        render(x, y, index, rank++);
+      index++;
+    }
+  } r{occ, 0, 0, render};
+  spacefill(occ.width(), occ.height(), r);
+}
+
+// aggregate of one go() node: its rectangle covers the curve indices
+// [begin, end), depth 0 is the whole grid
+template <typename T> struct reduce_node {
+  rect area;
+  std::int64_t begin, end;
+  int depth;
+  T value;
+};
+
+// One pass over the split tree: value(node) = combine over its cells of
+// leaf(x, y), starting from identity. Returns the nodes with at least
+// min_cells cells and depth <= max_depth, children before their parent.
+template <typename T, typename Leaf, typename Combine>
+std::vector<reduce_node<T>>
+spacefill_reduce(int ww, int hh, T identity, Leaf &&leaf, Combine &&combine,
+                 std::int64_t min_cells = 1, int max_depth = 1 << 30) {
+  struct reduce_render {
+    const T &identity;
+    Leaf &leaf;
+    Combine &combine;
+    std::int64_t min_cells, index;
+    int max_depth;
+    std::vector<std::pair<std::int64_t, T>> stack; // begin, value so far
+    std::vector<reduce_node<T>> nodes;
+    bool enter(int, int, int, int, int, int, char) {
+      stack.emplace_back(index, identity);
+      return true;
+    }
+    void leave(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char) {
+      std::int64_t begin = stack.back().first;
+      T value = std::move(stack.back().second);
+      stack.pop_back();
+      int depth = (int)stack.size();
+      if (index - begin >= min_cells && depth <= max_depth)
+        nodes.push_back(reduce_node<T>{node_rect(x0, y0, dxl, dyl, dxr, dyr),
+                                       begin, index, depth, value});
+      if (!stack.empty())
+        stack.back().second = combine(stack.back().second, value);
+    }
+    void operator()(int x, int y, char) {
+      stack.back().second = combine(stack.back().second, leaf(x, y));
+      index++;
+    }
+  } r{identity, leaf, combine, min_cells, 0, max_depth, {}, {}};
+  spacefill(ww, hh, r);
+  return std::move(r.nodes);
 }
+} // namespace hilbert_piano
 using hilbert_piano::spacefill;
+using hilbert_piano::spacefill_clip;
+using hilbert_piano::spacefill_masked;
+using hilbert_piano::spacefill_range;
+using hilbert_piano::spacefill_reduce;
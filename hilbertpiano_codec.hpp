@@ -0,0 +1,487 @@
+#pragma once
+/*
+Reference lossless image codec that scans pixels in spacefill() order, or
+in any order of hilbertpiano_orders.hpp for comparison.
+
+The scan is cut into chunks of chunk_cells consecutive cells that are coded
+independently, so the encoder works in memory bounded by one chunk and the
+decoder decodes chunks in parallel, or one at a time as a stream arrives.
+Inside a chunk every byte of a pixel is predicted from the mean of the pixel
+before it in the scan and of the 4-neighbors already coded in the same chunk;
+the residual is coded with an adaptive Golomb-Rice code per channel (k from
+the running mean, as in LOCO-I).
+
+Stream (little-endian):
+  "SFCI", u8 version, u8 channels, u8 order, u8 0, u32 width, u32 height,
+  u32 chunk_cells, then per chunk: u32 size, size bytes of Rice codes
+
+Speed: the scan is one hook-free walk per stream, the coder is bit-serial,
+every byte waits for the k, the unary prefix and the state update of the byte
+before it in its channel. That is about 20 MB/s per core each way and the
+reason it is a reference codec. The plan to GB/s keeps the stream layout of
+chunks: code each chunk as 32 interleaved lanes of static-k Rice (or rANS)
+with k per block of 64 residuals, so the decoder runs the lanes in SIMD
+registers, and compute the predictor per leaf of the curve from the
+row-major neighbors instead of the byte map. That is version 2 of the
+stream; version 1 stays decodable.
+*/
+
+#include "hilbertpiano.hpp"
+#include "hilbertpiano_orders.hpp"
+#include "hilbertpiano_pipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace hilbert_piano {
+namespace codec {
+
+static const unsigned char version = 1;
+static const std::size_t header_size = 20;
+
+// ids of the scan orders in the stream header
+template <typename Order> struct order_id;
+template <> struct order_id<order::tautenhahn> {
+  static const unsigned char value = 0;
+};
+template <> struct order_id<order::row_major> {
+  static const unsigned char value = 1;
+};
+template <> struct order_id<order::snake> {
+  static const unsigned char value = 2;
+};
+template <> struct order_id<order::morton> {
+  static const unsigned char value = 3;
+};
+template <> struct order_id<order::hilbert> {
+  static const unsigned char value = 4;
+};
+
+// calls f(Order()) for the order with order_id id
+template <typename F> void with_order(unsigned id, F &&f) {
+  switch (id) {
+  case order_id<order::tautenhahn>::value:
+    return f(order::tautenhahn());
+  case order_id<order::row_major>::value:
+    return f(order::row_major());
+  case order_id<order::snake>::value:
+    return f(order::snake());
+  case order_id<order::morton>::value:
+    return f(order::morton());
+  case order_id<order::hilbert>::value:
+    return f(order::hilbert());
+  }
+  throw std::runtime_error("sfc codec: unknown scan order");
+}
+
+// working memory of one chunk, reused across chunks
+struct chunk_map {
+  std::vector<unsigned char> seen; // cells coded so far
+};
+
+namespace detail {
+
+// unary prefix longer than this is an escape followed by the raw byte
+static const int rice_limit = 24;
+
+class bit_writer {
+public:
+  explicit bit_writer(std::vector<unsigned char> &out) : out(out) {}
+  void put(std::uint32_t bits, int count) { // LSB first, count <= 32
+    acc |= (std::uint64_t)bits << n;
+    n += count;
+    if (n >= 32) {
+      unsigned char b[4] = {(unsigned char)acc, (unsigned char)(acc >> 8),
+                            (unsigned char)(acc >> 16), (unsigned char)(acc >> 24)};
+      out.insert(out.end(), b, b + 4);
+      acc >>= 32;
+      n -= 32;
+    }
+  }
+  void flush() {
+    for (; n > 0; n -= 8) {
+      out.push_back((unsigned char)acc);
+      acc >>= 8;
+    }
+    acc = 0;
+    n = 0;
+  }
+
+private:
+  std::vector<unsigned char> &out;
+  std::uint64_t acc = 0;
+  int n = 0;
+};
+
+class bit_reader {
+public:
+  bit_reader(const unsigned char *p, const unsigned char *end)
+      : p(p), end(end) {}
+  std::uint32_t get(int count) {
+    if (n < count)
+      fill();
+    std::uint32_t v = (std::uint32_t)(acc & ((1ull << count) - 1));
+    acc >>= count;
+    n -= count;
+    return v;
+  }
+  // number of 0 bits before the next 1 bit, which is consumed too
+  int zeros() {
+    if (n < rice_limit + 1)
+      fill();
+    if ((acc & ((1ull << (rice_limit + 1)) - 1)) == 0)
+      throw std::runtime_error("sfc codec: corrupt chunk");
+#if defined(__GNUC__)
+    int z = __builtin_ctzll(acc);
+#else
+    int z = 0;
+    while (!((acc >> z) & 1))
+      z++;
+#endif
+    acc >>= z + 1;
+    n -= z + 1;
+    return z;
+  }
+
+private:
+  void fill() {
+    if (end - p >= 8) { // load a word, keep the whole bytes that fit
+      std::uint64_t w = (std::uint64_t)p[0] | (std::uint64_t)p[1] << 8 |
+                        (std::uint64_t)p[2] << 16 | (std::uint64_t)p[3] << 24 |
+                        (std::uint64_t)p[4] << 32 | (std::uint64_t)p[5] << 40 |
+                        (std::uint64_t)p[6] << 48 | (std::uint64_t)p[7] << 56;
+      acc |= w << n; // bits past n are the next bytes, or'ed in again later
+      p += (63 - n) >> 3;
+      n |= 56;
+      return;
+    }
+    while (n <= 56) {
+      std::uint64_t b = p < end ? *p++ : 0;
+      acc |= b << n;
+      n += 8;
+    }
+  }
+  const unsigned char *p, *end;
+  std::uint64_t acc = 0;
+  int n = 0;
+};
+
+// adaptive Golomb-Rice parameter of one channel
+struct rice_state {
+  std::uint32_t a = 4, n = 1;
+  int k() const { // smallest k <= 7 with n << k >= a, without branches
+    return (n < a) + (n << 1 < a) + (n << 2 < a) + (n << 3 < a) +
+           (n << 4 < a) + (n << 5 < a) + (n << 6 < a);
+  }
+  void update(std::uint32_t e) {
+    a += e;
+    if (++n == 32) {
+      a >>= 1;
+      n >>= 1;
+    }
+  }
+};
+
+inline std::uint32_t zigzag(int pixel, int pred) {
+  int r = (signed char)(unsigned char)(pixel - pred);
+  return r >= 0 ? 2 * r : -2 * r - 1;
+}
+
+inline unsigned char unzigzag(std::uint32_t e, int pred) {
+  int r = e & 1 ? -(int)((e + 1) / 2) : (int)(e / 2);
+  return (unsigned char)(pred + r);
+}
+
+// Cells of the scan order cut into chunks of chunk_cells, from one walk of
+// the hook-free spacefill_order() (order::tautenhahn keeps the Hilbert fast
+// path); chunk(cells, n, first) gets cells first .. first + n - 1
+template <typename Order, typename Chunk>
+void for_each_chunk(int ww, int hh, std::uint32_t chunk_cells, Chunk &&chunk) {
+  std::int64_t total = (std::int64_t)ww * hh;
+  std::vector<point> cells((std::size_t)std::min<std::int64_t>(chunk_cells, total));
+  std::size_t n = 0;
+  std::int64_t first = 0;
+  spacefill_order<Order>(ww, hh, [&](int x, int y, char) {
+    cells[n++] = point{x, y};
+    if (n == cells.size()) {
+      chunk((const point *)cells.data(), n, first);
+      first += n;
+      n = 0;
+    }
+  });
+  if (n)
+    chunk((const point *)cells.data(), n, first);
+}
+
+// Visits cells[0 .. n) and calls code(pixel, channel, pred) for every byte;
+// pixels of the 4-neighbors coded earlier in the chunk are valid by then, in
+// the encoder and the decoder.
+template <typename Pixel, typename Code>
+void walk_chunk(Pixel *pixels, int channels, std::size_t stride,
+                const point *cells, std::size_t n, chunk_map &map, Code &&code) {
+  // cells coded so far in this chunk, over the bounding box of the chunk and
+  // a border of one cell, so the 4-neighbors need no bounds checks
+  int x0 = cells[0].x, y0 = cells[0].y, x1 = x0, y1 = y0;
+  for (std::size_t i = 1; i < n; i++) {
+    x0 = std::min(x0, cells[i].x);
+    x1 = std::max(x1, cells[i].x);
+    y0 = std::min(y0, cells[i].y);
+    y1 = std::max(y1, cells[i].y);
+  }
+  std::ptrdiff_t bw = (std::ptrdiff_t)x1 - x0 + 3;
+  map.seen.assign((std::size_t)(bw * ((std::ptrdiff_t)y1 - y0 + 3)), 0);
+  unsigned char *seen = map.seen.data() + bw + 1;
+  // neighbors that are not available read zeros, which keeps the loop free of
+  // data dependent branches; (sum + n / 2) / n is (sum + n / 2) * recip[n]
+  // >> 16 for every sum of up to 5 bytes
+  static const unsigned char none[256] = {};
+  static const std::uint32_t recip[6] = {0, 65536, 32768, 21846, 16384, 13108};
+  int px = 0, py = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    int x = cells[i].x, y = cells[i].y;
+    unsigned char *s = seen + (y - y0) * bw + (x - x0);
+    Pixel *pixel = pixels + y * stride + (std::size_t)x * channels;
+    // the previous cell in the scan when it is not a 4-neighbor
+    int prev = i > 0 && (abs(px - x) + abs(py - y)) != 1;
+    const Pixel *known[5] = {
+        s[-1] ? pixel - channels : none, s[1] ? pixel + channels : none,
+        s[-bw] ? pixel - stride : none, s[bw] ? pixel + stride : none,
+        prev ? pixels + py * stride + (std::size_t)px * channels : none};
+    int count = s[-1] + s[1] + s[-bw] + s[bw] + prev;
+    for (int c = 0; c < channels; c++) {
+      std::uint32_t sum = known[0][c] + known[1][c] + known[2][c] +
+                          known[3][c] + known[4][c] + count / 2;
+      code(pixel + c, c, count ? (int)(sum * recip[count] >> 16) : 128);
+    }
+    *s = 1;
+    px = x;
+    py = y;
+  }
+}
+
+inline void put32(std::ostream &out, std::uint32_t v) {
+  unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8),
+                        (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+  out.write((const char *)b, 4);
+}
+
+inline std::uint32_t get32(const unsigned char *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (std::uint32_t)p[3] << 24;
+}
+} // namespace detail
+
+// ww x hh pixels of channels bytes each, rows stride bytes apart, scanned in
+// the order Order of hilbertpiano_orders.hpp
+template <typename Order = order::tautenhahn>
+void encode(const unsigned char *pixels, int ww, int hh, int channels,
+            std::size_t stride, std::ostream &out,
+            std::uint32_t chunk_cells = 1 << 16) {
+  if (ww <= 0 || hh <= 0 || channels <= 0 || channels > 255 || !chunk_cells)
+    throw std::invalid_argument("sfc codec: bad image size");
+  out.write("SFCI", 4);
+  unsigned char head[4] = {version, (unsigned char)channels,
+                           order_id<Order>::value, 0};
+  out.write((const char *)head, 4);
+  detail::put32(out, ww);
+  detail::put32(out, hh);
+  detail::put32(out, chunk_cells);
+
+  std::vector<unsigned char> bytes;
+  chunk_map map;
+  detail::for_each_chunk<Order>(ww, hh, chunk_cells, [&](const point *cells,
+                                                         std::size_t n,
+                                                         std::int64_t) {
+    bytes.clear();
+    detail::bit_writer bits(bytes);
+    detail::rice_state rice[255];
+    detail::walk_chunk(
+        pixels, channels, stride, cells, n, map,
+        [&](const unsigned char *p, int c, int pred) {
+          std::uint32_t e = detail::zigzag(*p, pred);
+          int k = rice[c].k();
+          std::uint32_t q = e >> k;
+          if (q < (std::uint32_t)detail::rice_limit) {
+            // unary q and the k low bits in one put, at most 31 bits
+            bits.put(1u << q | (e & ((1u << k) - 1)) << (q + 1), q + 1 + k);
+          } else {
+            bits.put(1u << detail::rice_limit, detail::rice_limit + 1);
+            bits.put(e, 8);
+          }
+          rice[c].update(e);
+        });
+    bits.flush();
+    detail::put32(out, (std::uint32_t)bytes.size());
+    out.write((const char *)bytes.data(), bytes.size());
+  });
+}
+
+struct header {
+  int width = 0, height = 0, channels = 0;
+  unsigned order = 0; // order_id of the scan order
+  std::uint32_t chunk_cells = 0;
+
+  std::int64_t cells() const { return (std::int64_t)width * height; }
+  std::int64_t chunks() const {
+    return (cells() + chunk_cells - 1) / chunk_cells;
+  }
+  // longest valid chunk: every byte escaped, rice_limit + 1 + 8 bits
+  std::size_t max_chunk_bytes() const {
+    return ((std::size_t)chunk_cells * channels * (detail::rice_limit + 9) + 7) / 8;
+  }
+};
+
+// the header_size bytes at the start of a stream
+inline header read_header(const unsigned char *data, std::size_t size) {
+  if (size < header_size || memcmp(data, "SFCI", 4) || data[4] != version)
+    throw std::runtime_error("sfc codec: not an SFCI stream");
+  header h;
+  h.channels = data[5];
+  h.order = data[6];
+  h.width = (int)detail::get32(data + 8);
+  h.height = (int)detail::get32(data + 12);
+  h.chunk_cells = detail::get32(data + 16);
+  if (h.channels <= 0 || h.width <= 0 || h.height <= 0 || !h.chunk_cells ||
+      data[7])
+    throw std::runtime_error("sfc codec: bad header");
+  with_order(h.order, [](auto) {});
+  return h;
+}
+
+inline header read_header(std::istream &in) {
+  unsigned char data[header_size];
+  in.read((char *)data, header_size);
+  return read_header(data, (std::size_t)in.gcount());
+}
+
+// Calls chunk(cells, n, first) for the chunks of a stream in order, with the
+// cells of each chunk in the order decode_chunk() takes them; one walk of
+// the scan order for all chunks.
+template <typename Chunk> void for_each_chunk(const header &h, Chunk &&chunk) {
+  with_order(h.order, [&](auto order) {
+    detail::for_each_chunk<decltype(order)>(h.width, h.height, h.chunk_cells,
+                                            chunk);
+  });
+}
+
+// Decodes one chunk, size bytes of Rice codes, into the pixels of cells[0 ..
+// n), which for_each_chunk() gives it; rows of the image are stride bytes
+// apart. Chunks do not depend on each other, they may be decoded in any
+// order and at the same time, each with its own chunk_map.
+inline void decode_chunk(const header &h, const unsigned char *bytes,
+                         std::size_t size, const point *cells, std::size_t n,
+                         unsigned char *pixels, std::size_t stride,
+                         chunk_map &map) {
+  detail::bit_reader bits(bytes, bytes + size);
+  detail::rice_state rice[255];
+  detail::walk_chunk(pixels, h.channels, stride, cells, n, map,
+                     [&](unsigned char *px, int c, int pred) {
+                       int k = rice[c].k();
+                       int q = bits.zeros();
+                       std::uint32_t e =
+                           q == detail::rice_limit
+                               ? bits.get(8)
+                               : ((std::uint32_t)q << k) | bits.get(k);
+                       *px = detail::unzigzag(e, pred);
+                       rice[c].update(e);
+                     });
+}
+
+// Decodes the chunks of a stream one at a time as they are read from in,
+// after read_header(in), into pixels with rows stride bytes apart; memory
+// besides the image is one chunk of cells and codes.
+inline void decode(std::istream &in, const header &h, unsigned char *pixels,
+                   std::size_t stride) {
+  std::vector<unsigned char> bytes;
+  chunk_map map;
+  for_each_chunk(h, [&](const point *cells, std::size_t n, std::int64_t) {
+    unsigned char size[4];
+    if (!in.read((char *)size, 4))
+      throw std::runtime_error("sfc codec: truncated stream");
+    if (detail::get32(size) > h.max_chunk_bytes())
+      throw std::runtime_error("sfc codec: corrupt chunk");
+    bytes.resize(detail::get32(size));
+    if (!in.read((char *)bytes.data(), bytes.size()))
+      throw std::runtime_error("sfc codec: truncated stream");
+    decode_chunk(h, bytes.data(), bytes.size(), cells, n, pixels, stride, map);
+  });
+}
+
+struct image {
+  int width = 0, height = 0, channels = 0;
+  std::vector<unsigned char> pixels; // rows of width*channels bytes
+};
+
+// decodes a whole stream held in memory: one thread walks the scan order,
+// threads - 1 workers decode its chunks (0 = one thread per core)
+inline image decode(const unsigned char *data, std::size_t size,
+                    unsigned threads = 0) {
+  header h = read_header(data, size);
+  image img;
+  img.width = h.width;
+  img.height = h.height;
+  img.channels = h.channels;
+  img.pixels.resize((std::size_t)h.cells() * h.channels);
+  std::size_t stride = (std::size_t)h.width * h.channels;
+
+  // chunk table from the size prefixes
+  std::int64_t chunks = h.chunks();
+  std::vector<const unsigned char *> starts(chunks), ends(chunks);
+  const unsigned char *p = data + header_size, *end = data + size;
+  for (std::int64_t i = 0; i < chunks; i++) {
+    if (end - p < 4 || (std::size_t)(end - p - 4) < detail::get32(p))
+      throw std::runtime_error("sfc codec: truncated stream");
+    starts[i] = p + 4;
+    ends[i] = p = starts[i] + detail::get32(p);
+  }
+
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads == 1 || chunks == 1) {
+    chunk_map map;
+    for_each_chunk(h, [&](const point *cells, std::size_t n, std::int64_t first) {
+      std::int64_t i = first / h.chunk_cells;
+      decode_chunk(h, starts[i], ends[i] - starts[i], cells, n,
+                   img.pixels.data(), stride, map);
+    });
+    return img;
+  }
+  // a chunk_map per worker, taken from a free list for each chunk
+  unsigned workers = threads - 1;
+  std::vector<chunk_map> maps(workers);
+  mpmc_ring<chunk_map *> free_maps(workers);
+  for (auto &m : maps)
+    free_maps.push(&m);
+  std::atomic<bool> failed{false};
+  with_order(h.order, [&](auto order) {
+    spacefill_pipelined<decltype(order)>(
+        h.width, h.height, workers,
+        [&](const point *cells, std::size_t n, std::size_t first) {
+          if (failed)
+            return;
+          std::size_t i = first / h.chunk_cells;
+          chunk_map *map = free_maps.pop();
+          try {
+            decode_chunk(h, starts[i], ends[i] - starts[i], cells, n,
+                         img.pixels.data(), stride, *map);
+          } catch (const std::runtime_error &) {
+            failed = true;
+          }
+          free_maps.push(map);
+        },
+        (std::size_t)std::min<std::int64_t>(h.chunk_cells, h.cells()),
+        2 * workers);
+  });
+  if (failed)
+    throw std::runtime_error("sfc codec: corrupt chunk");
+  return img;
+}
+} // namespace codec
+} // namespace hilbert_piano
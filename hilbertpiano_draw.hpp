@@ -0,0 +1,257 @@
+#pragma once
+/*
+Streaming output of the curve as a polyline. run_merger turns the cells of
+spacefill() into the vertices where the curve changes direction, so long
+straight runs become one segment; the writers consume the vertices as they
+come and never hold the point list.
+
+  hilbert_piano::svg_writer svg(out, ww, hh, 4);
+  hilbert_piano::draw(ww, hh, svg);
+
+svg_writer / ps_writer  path through the cell centers as relative
+                        horizontal/vertical steps, scale units per cell
+raster_writer           ww*scale x hh*scale PGM (gray) or PPM (colored by
+                        curve position) drawn straight into a mapped file
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace hilbert_piano {
+
+// render callback that calls sink.vertex(x, y, index) for the first cell,
+// every cell where the direction changes and, after finish(), the last cell
+template <typename Sink> class run_merger {
+public:
+  explicit run_merger(Sink &sink) : sink(sink) {}
+  void operator()(int x, int y, char) {
+    if (index > 0) {
+      int dx = x - last.x, dy = y - last.y;
+      if (index > 1 && (dx != step.x || dy != step.y))
+        sink.vertex(last.x, last.y, index - 1);
+      step = point{dx, dy};
+    } else
+      sink.vertex(x, y, 0);
+    last = point{x, y};
+    index++;
+  }
+  void finish() {
+    if (index > 1)
+      sink.vertex(last.x, last.y, index - 1);
+  }
+
+private:
+  Sink &sink;
+  point last{0, 0}, step{0, 0};
+  std::int64_t index = 0;
+};
+
+template <typename Sink> void draw(int ww, int hh, Sink &sink) {
+  run_merger<Sink> merge(sink);
+  spacefill(ww, hh, merge);
+  merge.finish();
+  sink.finish();
+}
+
+namespace detail {
+// text path writer base: buffers output and formats integers by hand,
+// ostream formatting dominates the run time otherwise
+class path_text {
+protected:
+  explicit path_text(std::ostream &out) : out(out) {}
+  ~path_text() { flush(); }
+  void put(const char *s) {
+    while (*s)
+      buf[len++] = *s++;
+  }
+  void put(std::int64_t v) {
+    char digits[24];
+    int n = 0;
+    std::uint64_t u = v < 0 ? 0 - (std::uint64_t)v : v;
+    do
+      digits[n++] = '0' + u % 10;
+    while (u /= 10);
+    if (v < 0)
+      buf[len++] = '-';
+    while (n)
+      buf[len++] = digits[--n];
+  }
+  // call after every vertex, a vertex needs less than 64 bytes
+  void maybe_flush() {
+    if (len > sizeof buf - 64)
+      flush();
+  }
+  void flush() {
+    out.write(buf, len);
+    len = 0;
+  }
+  std::ostream &out;
+  char buf[1 << 16];
+  std::size_t len = 0;
+};
+} // namespace detail
+
+// one path of relative h/v steps between cell centers
+class svg_writer : detail::path_text {
+public:
+  svg_writer(std::ostream &out, int ww, int hh, int scale = 4)
+      : path_text(out), scale(scale) {
+    put("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    put((std::int64_t)ww * scale);
+    put("\" height=\"");
+    put((std::int64_t)hh * scale);
+    put("\">\n<path fill=\"none\" stroke=\"black\" stroke-width=\"");
+    put((std::int64_t)(scale + 3) / 4);
+    put("\" d=\"");
+  }
+  void vertex(int x, int y, std::int64_t index) {
+    if (index == 0) {
+      put("M");
+      put((std::int64_t)x * scale + scale / 2);
+      put(" ");
+      put((std::int64_t)y * scale + scale / 2);
+    } else if (x != lx) {
+      put("h");
+      put((std::int64_t)(x - lx) * scale);
+    } else {
+      put("v");
+      put((std::int64_t)(y - ly) * scale);
+    }
+    if (++n % 32 == 0)
+      put("\n");
+    lx = x;
+    ly = y;
+    maybe_flush();
+  }
+  void finish() {
+    put("\"/>\n</svg>\n");
+    flush();
+  }
+
+private:
+  int scale, lx = 0, ly = 0;
+  std::int64_t n = 0;
+};
+
+// relative h/v steps as well, y grows upwards in PostScript
+class ps_writer : detail::path_text {
+public:
+  ps_writer(std::ostream &out, int ww, int hh, int scale = 4)
+      : path_text(out), hh(hh), scale(scale) {
+    put("%!PS-Adobe-3.0 EPSF-3.0\n%%BoundingBox: 0 0 ");
+    put((std::int64_t)ww * scale);
+    put(" ");
+    put((std::int64_t)hh * scale);
+    put("\n/h { 0 rlineto } bind def /v { 0 exch rlineto } bind def\n");
+    put((std::int64_t)(scale + 3) / 4);
+    put(" setlinewidth 1 setlinejoin newpath\n");
+  }
+  void vertex(int x, int y, std::int64_t index) {
+    if (index == 0) {
+      put((std::int64_t)x * scale + scale / 2);
+      put(" ");
+      put((std::int64_t)(hh - 1 - y) * scale + scale / 2);
+      put(" moveto\n");
+    } else {
+      put((std::int64_t)(x != lx ? x - lx : ly - y) * scale);
+      put(x != lx ? " h\n" : " v\n");
+      // stroke in pieces, interpreters limit the path length
+      if (++n % 1000 == 0)
+        put("currentpoint stroke moveto\n");
+    }
+    lx = x;
+    ly = y;
+    maybe_flush();
+  }
+  void finish() {
+    put("stroke\nshowpage\n%%EOF\n");
+    flush();
+  }
+
+private:
+  int hh, scale, lx = 0, ly = 0;
+  std::int64_t n = 0;
+};
+
+class raster_writer {
+public:
+  // channels 1 writes a PGM, 3 a PPM; the file is created with the final
+  // size and drawn through a shared mapping
+  raster_writer(const std::string &file, int ww, int hh, int scale = 1,
+                int channels = 1)
+      : ww(ww * scale), hh(hh * scale), scale(scale), channels(channels),
+        cells((std::int64_t)ww * hh) {
+    char head[64];
+    int len = snprintf(head, sizeof head, "P%d\n%d %d\n255\n",
+                       channels == 3 ? 6 : 5, this->ww, this->hh);
+    size = len + (std::size_t)this->ww * this->hh * channels;
+    int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+      int e = errno;
+      if (fd >= 0)
+        ::close(fd);
+      throw std::system_error(e, std::generic_category(), file);
+    }
+    map = (unsigned char *)mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+      throw std::system_error(errno, std::generic_category(), file);
+    memcpy(map, head, len);
+    pixels = map + len;
+    memset(pixels, 255, size - len);
+  }
+  raster_writer(const raster_writer &) = delete;
+  raster_writer &operator=(const raster_writer &) = delete;
+  ~raster_writer() { munmap(map, size); }
+
+  void vertex(int x, int y, std::int64_t index) {
+    int px = x * scale + scale / 2, py = y * scale + scale / 2;
+    if (index == 0)
+      plot(px, py, 0);
+    else { // segments of the merged curve are horizontal or vertical
+      int dx = (px > lx) - (px < lx), dy = (py > ly) - (py < ly);
+      std::int64_t steps = (std::int64_t)abs(px - lx) + abs(py - ly);
+      for (std::int64_t s = 1; s <= steps; s++)
+        plot(lx + dx * (int)s, ly + dy * (int)s,
+             last_index + (index - last_index) * s / steps);
+    }
+    lx = px;
+    ly = py;
+    last_index = index;
+  }
+  void finish() { msync(map, size, MS_ASYNC); }
+
+private:
+  void plot(int px, int py, std::int64_t index) {
+    unsigned char *p = pixels + ((std::size_t)py * ww + px) * channels;
+    if (channels == 1) {
+      *p = 0;
+      return;
+    }
+    // blue -> green -> red along the curve
+    int t = (int)(510 * index / (cells > 1 ? cells - 1 : 1));
+    p[0] = t > 255 ? t - 255 : 0;
+    p[1] = t > 255 ? 510 - t : t;
+    p[2] = t > 255 ? 0 : 255 - t;
+  }
+
+  int ww, hh, scale, channels;
+  std::int64_t cells, last_index = 0;
+  int lx = 0, ly = 0;
+  unsigned char *map, *pixels;
+  std::size_t size;
+};
+} // namespace hilbert_piano
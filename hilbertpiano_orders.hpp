@@ -0,0 +1,126 @@
+#pragma once
+/*
+Alternative traversal orders behind the spacefill() callback interface, so
+kernels that are generic over the order can compare them:
+
+  hilbert_piano::spacefill_order<hilbert_piano::order::snake>(
+      ww, hh, [](int x, int y, char dir) { ... });
+
+order::tautenhahn  the Peano/Hilbert curve of spacefill()
+order::row_major   rows top->down, each row left->right
+order::snake       boustrophedon, odd rows right->left
+order::morton      Z order, quadrants outside the grid are pruned
+order::hilbert     Hilbert curve of the enclosing 2^k square, clipped to the grid
+
+Only order::tautenhahn reports a dir, the other orders pass 0. order::hilbert
+throws std::invalid_argument for a side over 2^29.
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <stdexcept>
+
+namespace hilbert_piano {
+namespace order {
+
+struct tautenhahn {
+  static const char *name() { return "tautenhahn"; }
+  template <typename RenderCallback>
+  static void fill(int ww, int hh, RenderCallback &&render) {
+    spacefill(ww, hh, render);
+  }
+};
+
+struct row_major {
+  static const char *name() { return "row-major"; }
+  template <typename RenderCallback>
+  static void fill(int ww, int hh, RenderCallback &&render) {
+    for (int y = 0; y < hh; y++)
+      for (int x = 0; x < ww; x++)
+        render(x, y, char(0));
+  }
+};
+
+struct snake {
+  static const char *name() { return "snake"; }
+  template <typename RenderCallback>
+  static void fill(int ww, int hh, RenderCallback &&render) {
+    for (int y = 0; y < hh; y++)
+      if (y % 2 == 0)
+        for (int x = 0; x < ww; x++)
+          render(x, y, char(0));
+      else
+        for (int x = ww - 1; x >= 0; x--)
+          render(x, y, char(0));
+  }
+};
+
+struct morton {
+  static const char *name() { return "morton"; }
+  template <typename RenderCallback>
+  static void fill(int ww, int hh, RenderCallback &&render) {
+    int size = 1;
+    while (size < ww || size < hh)
+      size *= 2;
+    quadrant(0, 0, size, ww, hh, render);
+  }
+
+private:
+  template <typename RenderCallback>
+  static void quadrant(int x0, int y0, int size, int ww, int hh,
+                       RenderCallback &render) {
+    if (x0 >= ww || y0 >= hh)
+      return;
+    if (size == 2) {
+      render(x0, y0, char(0));
+      if (x0 + 1 < ww)
+        render(x0 + 1, y0, char(0));
+      if (y0 + 1 < hh) {
+        render(x0, y0 + 1, char(0));
+        if (x0 + 1 < ww)
+          render(x0 + 1, y0 + 1, char(0));
+      }
+      return;
+    }
+    if (size == 1) {
+      render(x0, y0, char(0));
+      return;
+    }
+    int half = size / 2;
+    quadrant(x0, y0, half, ww, hh, render);
+    quadrant(x0 + half, y0, half, ww, hh, render);
+    quadrant(x0, y0 + half, half, ww, hh, render);
+    quadrant(x0 + half, y0 + half, half, ww, hh, render);
+  }
+};
+
+struct hilbert {
+  static const char *name() { return "hilbert"; }
+  // spacefill() of a 2^k square is a plain Hilbert curve, clipping prunes the
+  // padding outside the grid; the square side is limited to 2^29, go() works
+  // with twice the side in int
+  static const int max_side = 1 << 29;
+  template <typename RenderCallback>
+  static void fill(int ww, int hh, RenderCallback &&render) {
+    if (ww > max_side || hh > max_side)
+      throw std::invalid_argument("order::hilbert: grid side over 2^29");
+    int size = 1;
+    while (size < ww || size < hh)
+      size *= 2;
+    if (size == ww && size == hh) {
+      spacefill(ww, hh, [&](int x, int y, char) { render(x, y, char(0)); });
+      return;
+    }
+    spacefill_clip(size, size, rect{0, 0, ww, hh},
+                   [&](int x, int y, std::int64_t) { render(x, y, char(0)); });
+  }
+};
+
+} // namespace order
+
+template <typename Order, typename RenderCallback>
+void spacefill_order(int ww, int hh, RenderCallback &&render) {
+  Order::fill(ww, hh, render);
+}
+} // namespace hilbert_piano
+using hilbert_piano::spacefill_order;
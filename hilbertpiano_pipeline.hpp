@@ -0,0 +1,176 @@
+#pragma once
+/*
+Pipelined traversal: one thread runs spacefill() and hands out fixed-size
+batches of cells, consumer threads process the batches in parallel.
+
+  hilbert_piano::spacefill_pipelined(ww, hh, 4,
+      [](const hilbert_piano::point *pts, std::size_t n, std::size_t first) {
+        // pts[i] is cell number first + i of the curve
+      });
+
+Batches come from a fixed pool, so the generator blocks (back-pressure)
+once all of them are queued or in use. consume() runs concurrently on
+several threads and must not throw. spacefill_pipelined<Order>(...) hands
+out the cells of another order of hilbertpiano_orders.hpp.
+*/
+
+#include "hilbertpiano.hpp"
+#include "hilbertpiano_orders.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace hilbert_piano {
+
+// bounded lock-free multi-producer/multi-consumer ring (D. Vyukov), the
+// capacity is rounded up to a power of two
+template <typename T> class mpmc_ring {
+public:
+  explicit mpmc_ring(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    mask = size - 1;
+    cells.reset(new cell[size]);
+    for (std::size_t i = 0; i < size; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool try_push(const T &value) {
+    cell *c;
+    std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells[pos & mask];
+      std::size_t seq = c->seq.load(std::memory_order_acquire);
+      std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          break;
+      } else if (diff < 0)
+        return false; // full
+      else
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+    c->value = value;
+    c->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T &value) {
+    cell *c;
+    std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells[pos & mask];
+      std::size_t seq = c->seq.load(std::memory_order_acquire);
+      std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          break;
+      } else if (diff < 0)
+        return false; // empty
+      else
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+    value = c->value;
+    c->seq.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  void push(const T &value) {
+    while (!try_push(value))
+      std::this_thread::yield();
+  }
+
+  T pop() {
+    T value;
+    while (!try_pop(value))
+      std::this_thread::yield();
+    return value;
+  }
+
+private:
+  struct cell {
+    std::atomic<std::size_t> seq;
+    T value;
+  };
+  std::unique_ptr<cell[]> cells;
+  std::size_t mask;
+  alignas(64) std::atomic<std::size_t> enqueue_pos{0};
+  alignas(64) std::atomic<std::size_t> dequeue_pos{0};
+};
+
+template <typename Order = order::tautenhahn, typename Consumer>
+void spacefill_pipelined(int ww, int hh, unsigned consumers,
+                         Consumer &&consume, std::size_t batch_size = 4096,
+                         std::size_t batches = 64) // width, height, consumer
+                                                   // threads, batch callback
+{
+  struct batch {
+    std::size_t first, count;
+    std::vector<point> pts;
+  };
+  if (consumers == 0)
+    consumers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+  if (batch_size == 0)
+    batch_size = 1;
+  if (batches < consumers + 1)
+    batches = consumers + 1; // every consumer busy and one being filled
+
+  std::vector<batch> pool(batches);
+  mpmc_ring<batch *> free_batches(batches), full_batches(batches + consumers);
+  for (auto &b : pool) {
+    b.pts.resize(batch_size);
+    free_batches.push(&b);
+  }
+
+  std::vector<std::thread> threads;
+  try {
+    for (unsigned i = 0; i < consumers; i++)
+      threads.emplace_back([&] {
+        for (;;) {
+          batch *b = full_batches.pop();
+          if (!b)
+            return; // end of the curve
+          consume(b->pts.data(), b->count, b->first);
+          free_batches.push(b);
+        }
+      });
+  } catch (...) {
+    // stop and join the consumers that did start, destroying a joinable
+    // thread calls std::terminate
+    for (std::size_t i = 0; i < threads.size(); i++)
+      full_batches.push(nullptr);
+    for (auto &t : threads)
+      t.join();
+    throw;
+  }
+
+  batch *cur = free_batches.pop();
+  std::size_t index = 0;
+  cur->first = 0;
+  cur->count = 0;
+  spacefill_order<Order>(ww, hh, [&](int x, int y, char) {
+    cur->pts[cur->count++] = point{x, y};
+    index++;
+    if (cur->count == batch_size) {
+      full_batches.push(cur);
+      cur = free_batches.pop();
+      cur->first = index;
+      cur->count = 0;
+    }
+  });
+  if (cur->count)
+    full_batches.push(cur);
+  for (unsigned i = 0; i < consumers; i++)
+    full_batches.push(nullptr);
+  for (auto &t : threads)
+    t.join();
+}
+} // namespace hilbert_piano
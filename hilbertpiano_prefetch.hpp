@@ -0,0 +1,63 @@
+#pragma once
+/*
+Traversal that runs ahead of the render callback and prefetches the user data
+of the cells it will visit next, to hide memory latency when the callback
+loads data that is laid out in another order (a row-major image too large to
+reorder, a tiled store, ...).
+
+  hilbert_piano::spacefill_prefetch(ww, hh, 32,
+      [&](int x, int y) -> const void * { return &image[(size_t)y * ww + x]; },
+      [&](int x, int y, char dir) { use(image[(size_t)y * ww + x]); });
+
+address(x, y) maps a cell to the address of its data. It is called distance
+cells before render(x, y, dir) sees the same cell, which is when the prefetch
+is issued; cells still reach render() in curve order.
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace hilbert_piano {
+
+inline void prefetch(const void *address) {
+#if defined(__GNUC__)
+  __builtin_prefetch(address, 0, 3);
+#else
+  (void)address;
+#endif
+}
+
+template <typename Address, typename RenderCallback>
+void spacefill_prefetch(int ww, int hh, int distance, Address &&address,
+                        RenderCallback &&render) {
+  struct cell {
+    int x, y;
+    char dir;
+  };
+  if (distance <= 0) {
+    spacefill(ww, hh, render);
+    return;
+  }
+  std::size_t size = 1;
+  while (size < (std::size_t)distance)
+    size *= 2;
+  std::vector<cell> ring(size);
+  std::size_t head = 0, tail = 0; // cells [tail, head) wait for render()
+
+  spacefill(ww, hh, [&](int x, int y, char dir) {
+    prefetch(address(x, y));
+    if (head - tail == (std::size_t)distance) {
+      const cell &c = ring[tail++ & (size - 1)];
+      render(c.x, c.y, c.dir);
+    }
+    ring[head++ & (size - 1)] = cell{x, y, dir};
+  });
+  while (tail != head) {
+    const cell &c = ring[tail++ & (size - 1)];
+    render(c.x, c.y, c.dir);
+  }
+}
+} // namespace hilbert_piano
+using hilbert_piano::spacefill_prefetch;
@@ -0,0 +1,210 @@
+#pragma once
+/*
+Persistent forward (index -> x, y) and inverse (x, y -> index) tables of the
+curve, one file per grid size in a cache directory, mapped with mmap so all
+processes share the same pages and startup does not run spacefill().
+
+  hilbert_piano::table_cache cache("/var/cache/sfc");
+  hilbert_piano::curve_table t = cache.open(ww, hh); // builds the file once
+  hilbert_piano::point p = t.at(i);
+  std::uint32_t i = t.index(x, y);
+
+File sfc_<W>x<H>.tbl (host byte order):
+  header (64 bytes): "SFCT", u32 version, u32 width, u32 height, u64 cells,
+                     u64 checksum of the tables, zero padding
+  forward: cells x (u32 x, u32 y)
+  inverse: cells x u32, row-major
+
+open() checks the header only; verify() checks the table checksum. A file is
+written under a unique temporary name (mkstemp) and renamed into place, so
+threads and processes on any host racing to create the same table never see
+a partial file. POSIX only, grids up to 2^32 - 1 cells and sides up to 2^29.
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hilbert_piano {
+
+namespace detail {
+struct table_header {
+  char magic[4];
+  std::uint32_t version, width, height;
+  std::uint64_t cells, checksum;
+  char reserved[32];
+};
+static_assert(sizeof(table_header) == 64, "table header must be 64 bytes");
+
+static const std::uint32_t table_version = 1;
+
+inline std::uint64_t table_checksum(const std::uint32_t *data, std::size_t n) {
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < n; i++)
+    h = (h ^ data[i]) * 0x100000001b3ull;
+  return h;
+}
+
+inline std::system_error os_error(const std::string &what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+} // namespace detail
+
+class curve_table {
+public:
+  curve_table() = default;
+  curve_table(curve_table &&o) noexcept { *this = std::move(o); }
+  curve_table &operator=(curve_table &&o) noexcept {
+    std::swap(map, o.map);
+    std::swap(size, o.size);
+    return *this;
+  }
+  curve_table(const curve_table &) = delete;
+  curve_table &operator=(const curve_table &) = delete;
+  ~curve_table() {
+    if (map)
+      munmap(map, size);
+  }
+
+  int width() const { return header()->width; }
+  int height() const { return header()->height; }
+  std::uint64_t cells() const { return header()->cells; }
+  // x, y of cell number i of the curve, as 2*cells() u32
+  const std::uint32_t *forward() const {
+    return (const std::uint32_t *)((const char *)map + sizeof(detail::table_header));
+  }
+  // curve index of cell x, y at [y*width()+x]
+  const std::uint32_t *inverse() const { return forward() + 2 * cells(); }
+  point at(std::uint64_t i) const {
+    return point{(int)forward()[2 * i], (int)forward()[2 * i + 1]};
+  }
+  std::uint32_t index(int x, int y) const {
+    return inverse()[(std::size_t)y * width() + x];
+  }
+  // reads all pages, true if the tables match the header checksum
+  bool verify() const {
+    return detail::table_checksum(forward(), 3 * cells()) == header()->checksum;
+  }
+
+private:
+  friend class table_cache;
+  const detail::table_header *header() const {
+    return (const detail::table_header *)map;
+  }
+  void *map = nullptr;
+  std::size_t size = 0;
+};
+
+class table_cache {
+public:
+  explicit table_cache(std::string dir) : dir(std::move(dir)) {}
+
+  std::string path(int ww, int hh) const {
+    return dir + "/sfc_" + std::to_string(ww) + "x" + std::to_string(hh) + ".tbl";
+  }
+
+  // maps the table of ww x hh, building the file first if it is missing or
+  // its header does not match (other version, other size, truncated)
+  curve_table open(int ww, int hh) const {
+    // indices are u32; go() works with 3 times a side in int
+    if (ww <= 0 || hh <= 0 || ww > 1 << 29 || hh > 1 << 29 ||
+        (std::uint64_t)ww * hh > 0xffffffffull)
+      throw std::invalid_argument("sfc table: bad grid size");
+    curve_table t;
+    if (map(path(ww, hh), ww, hh, t))
+      return t;
+    build(ww, hh);
+    if (!map(path(ww, hh), ww, hh, t))
+      throw std::runtime_error("sfc table: cannot map " + path(ww, hh));
+    return t;
+  }
+
+  // writes the table of ww x hh, replacing an existing file
+  void build(int ww, int hh) const {
+    std::uint64_t cells = (std::uint64_t)ww * hh;
+    std::size_t size = sizeof(detail::table_header) + 12 * cells;
+    // unique per thread and host, unlike a name made from the pid
+    std::string tmp = path(ww, hh) + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0)
+      throw detail::os_error(tmp);
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, size) < 0) {
+      int e = errno;
+      ::close(fd);
+      unlink(tmp.c_str());
+      errno = e;
+      throw detail::os_error(tmp);
+    }
+    void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+      unlink(tmp.c_str());
+      throw detail::os_error(tmp);
+    }
+    auto *h = (detail::table_header *)m;
+    auto *fwd = (std::uint32_t *)(h + 1), *inv = fwd + 2 * cells;
+    std::uint64_t i = 0; // 2 * i passes 2^32
+    spacefill(ww, hh, [&](int x, int y, char) {
+      fwd[2 * i] = x;
+      fwd[2 * i + 1] = y;
+      inv[(std::size_t)y * ww + x] = (std::uint32_t)i++;
+    });
+    memcpy(h->magic, "SFCT", 4);
+    h->version = detail::table_version;
+    h->width = ww;
+    h->height = hh;
+    h->cells = cells;
+    h->checksum = detail::table_checksum(fwd, 3 * cells);
+    int synced = msync(m, size, MS_SYNC);
+    munmap(m, size);
+    if (synced < 0 || rename(tmp.c_str(), path(ww, hh).c_str()) < 0) {
+      int e = errno;
+      unlink(tmp.c_str());
+      errno = e;
+      throw detail::os_error(path(ww, hh));
+    }
+  }
+
+private:
+  static bool map(const std::string &file, int ww, int hh, curve_table &t) {
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    std::uint64_t cells = (std::uint64_t)ww * hh;
+    std::size_t size = sizeof(detail::table_header) + 12 * cells;
+    if (fstat(fd, &st) < 0 || (std::uint64_t)st.st_size != size) {
+      ::close(fd);
+      return false;
+    }
+    void *m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED)
+      return false;
+    auto *h = (const detail::table_header *)m;
+    if (memcmp(h->magic, "SFCT", 4) || h->version != detail::table_version ||
+        h->width != (std::uint32_t)ww || h->height != (std::uint32_t)hh ||
+        h->cells != cells) {
+      munmap(m, size);
+      return false;
+    }
+    t.map = m;
+    t.size = size;
+    return true;
+  }
+
+  std::string dir;
+};
+} // namespace hilbert_piano
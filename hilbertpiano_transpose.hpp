@@ -0,0 +1,84 @@
+#pragma once
+/*
+Out-of-place transpose and rotations of a ww x hh matrix of any size. The
+source is walked in spacefill() order of the go() nodes; a node of at most
+block_cells cells is copied with plain loops. Consecutive nodes are
+neighbors, so the rows read and the mirrored rows written stay in cache
+and TLB without a block size tuned per machine.
+
+Strides are in elements. The destination is hh x ww for transpose and the
+90 degree rotations, ww x hh for rotate180.
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hilbert_piano {
+
+namespace detail {
+// dst at map(x, y) = src at (x, y) for every cell of the source
+template <typename T, typename Map>
+void remap(const T *src, int ww, int hh, std::size_t src_stride, T *dst,
+           std::size_t dst_stride, std::int64_t block_cells, Map map) {
+  if (block_cells <= 0) // about 8 KiB of source per block
+    block_cells = sizeof(T) < 512 ? 8192 / sizeof(T) : 16;
+  struct block_render {
+    const T *src;
+    std::size_t src_stride;
+    T *dst;
+    std::size_t dst_stride;
+    std::int64_t block_cells;
+    Map &map;
+    void copy(int x, int y) {
+      point d = map(x, y);
+      dst[(std::size_t)d.y * dst_stride + d.x] =
+          src[(std::size_t)y * src_stride + x];
+    }
+    bool enter(int x0, int y0, int dxl, int dyl, int dxr, int dyr, char) {
+      if (node_cells(dxl, dyl, dxr, dyr) > block_cells)
+        return true;
+      rect r = node_rect(x0, y0, dxl, dyl, dxr, dyr);
+      for (int y = r.y; y < r.y + r.h; y++)
+        for (int x = r.x; x < r.x + r.w; x++)
+          copy(x, y);
+      return false;
+    }
+    void operator()(int x, int y, char) { copy(x, y); }
+  } r{src, src_stride, dst, dst_stride, block_cells, map};
+  spacefill(ww, hh, r);
+}
+} // namespace detail
+
+// dst[x][y] = src[y][x]
+template <typename T>
+void transpose(const T *src, int ww, int hh, std::size_t src_stride, T *dst,
+               std::size_t dst_stride, std::int64_t block_cells = 0) {
+  detail::remap(src, ww, hh, src_stride, dst, dst_stride, block_cells,
+                [](int x, int y) { return point{y, x}; });
+}
+
+// clockwise: the first source row becomes the last destination column
+template <typename T>
+void rotate90(const T *src, int ww, int hh, std::size_t src_stride, T *dst,
+              std::size_t dst_stride, std::int64_t block_cells = 0) {
+  detail::remap(src, ww, hh, src_stride, dst, dst_stride, block_cells,
+                [hh](int x, int y) { return point{hh - 1 - y, x}; });
+}
+
+// counter-clockwise: the first source row becomes the first destination column
+template <typename T>
+void rotate270(const T *src, int ww, int hh, std::size_t src_stride, T *dst,
+               std::size_t dst_stride, std::int64_t block_cells = 0) {
+  detail::remap(src, ww, hh, src_stride, dst, dst_stride, block_cells,
+                [ww](int x, int y) { return point{y, ww - 1 - x}; });
+}
+
+template <typename T>
+void rotate180(const T *src, int ww, int hh, std::size_t src_stride, T *dst,
+               std::size_t dst_stride, std::int64_t block_cells = 0) {
+  detail::remap(src, ww, hh, src_stride, dst, dst_stride, block_cells,
+                [ww, hh](int x, int y) { return point{ww - 1 - x, hh - 1 - y}; });
+}
+} // namespace hilbert_piano
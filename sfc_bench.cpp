@@ -0,0 +1,89 @@
+/*
+Throughput of a 5-point stencil over a W x H float image, visited in each
+traversal order of hilbertpiano_orders.hpp. The stencil reads the row above
+and below, so row-major order streams three rows while the curves keep the
+neighborhood in cache; the numbers show at which sizes that pays off. The
+last line is the curve through spacefill_prefetch(), prefetching the row
+below DISTANCE cells ahead.
+
+  sfc_bench W H [REPEAT] [DISTANCE]
+*/
+
+#include "hilbertpiano_orders.hpp"
+#include "hilbertpiano_prefetch.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// traverse(stencil) visits every cell with stencil(x, y, dir)
+template <typename Traverse>
+static void run(const char *name, int ww, int hh, int repeat,
+                const std::vector<float> &in, std::vector<float> &out,
+                Traverse &&traverse) {
+  double best = 1e30, checksum = 0;
+  for (int r = 0; r < repeat; r++) {
+    auto start = std::chrono::steady_clock::now();
+    traverse([&](int x, int y, char) {
+      std::size_t i = (std::size_t)y * ww + x;
+      float sum = 4 * in[i];
+      sum -= x > 0 ? in[i - 1] : in[i];
+      sum -= x + 1 < ww ? in[i + 1] : in[i];
+      sum -= y > 0 ? in[i - ww] : in[i];
+      sum -= y + 1 < hh ? in[i + ww] : in[i];
+      out[i] = sum;
+    });
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count();
+    if (t < best)
+      best = t;
+  }
+  for (std::size_t i = 0; i < out.size(); i += 97)
+    checksum += out[i];
+  printf("%-12s %10.3f ms %8.2f ns/cell  (%g)\n", name, best * 1e3,
+         best * 1e9 / ((double)ww * hh), checksum);
+}
+
+template <typename Order>
+static void run(int ww, int hh, int repeat, const std::vector<float> &in,
+                std::vector<float> &out) {
+  run(Order::name(), ww, hh, repeat, in, out,
+      [&](auto &&stencil) { spacefill_order<Order>(ww, hh, stencil); });
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: sfc_bench W H [REPEAT] [DISTANCE]\n");
+    return 2;
+  }
+  int ww = atoi(argv[1]), hh = atoi(argv[2]);
+  int repeat = argc > 3 ? atoi(argv[3]) : 5;
+  int distance = argc > 4 ? atoi(argv[4]) : 16;
+  if (ww <= 0 || hh <= 0 || repeat <= 0 || distance < 0) {
+    fprintf(stderr, "sfc_bench: bad size\n");
+    return 2;
+  }
+  std::vector<float> in((std::size_t)ww * hh), out(in.size());
+  for (std::size_t i = 0; i < in.size(); i++)
+    in[i] = (float)((i * 2654435761u) % 1000);
+
+  namespace order = hilbert_piano::order;
+  run<order::tautenhahn>(ww, hh, repeat, in, out);
+  run<order::row_major>(ww, hh, repeat, in, out);
+  run<order::snake>(ww, hh, repeat, in, out);
+  run<order::morton>(ww, hh, repeat, in, out);
+  run<order::hilbert>(ww, hh, repeat, in, out);
+  char name[32];
+  snprintf(name, sizeof name, "prefetch %d", distance);
+  run(name, ww, hh, repeat, in, out, [&](auto &&stencil) {
+    spacefill_prefetch(
+        ww, hh, distance,
+        [&](int x, int y) -> const void * {
+          return &in[(std::size_t)(y + 1 < hh ? y + 1 : y) * ww + x];
+        },
+        stencil);
+  });
+  return 0;
+}
@@ -0,0 +1,245 @@
+/*
+Replays the memory accesses of a kernel run over a W x H grid in a given
+traversal order through a set-associative LRU cache and TLB model and prints
+the predicted misses of the curve next to row-major, snake, Morton (Z) and
+padded Hilbert order.
+
+  sfc_cachesim W H [--elem BYTES] [--stride BYTES] [--stencil R]
+               [--dst row|col|tile:T] [--dst-stride BYTES] [--line BYTES]
+               [--l1 SIZE:WAYS] [--l2 SIZE:WAYS] [--l3 SIZE:WAYS]
+               [--page BYTES] [--tlb ENTRIES:WAYS] [--stlb ENTRIES:WAYS]
+
+For every cell x, y the kernel loads the source element x, y and, with
+--stencil R, the cells up to R steps away along the row and the column
+inside the grid (R = 1 is the 5-point stencil of sfc_bench). With --dst it
+then stores one element of a second array of the same element size:
+  row     at y*dst_stride + x*elem (dst_stride defaults to W*elem)
+  col     transposed, at x*dst_stride + y*elem (defaults to H*elem)
+  tile:T  T x T tiles stored one after the other, row-major inside a tile
+The destination starts on the page after the source. One pass that only
+loads each element once touches every line once in any order, so the
+orders only differ once a stencil or a destination in another layout adds
+reuse and conflicts.
+
+The source element x, y lives at y*stride + x*elem (stride defaults to
+W*elem).
+Sizes take K/M/G suffixes, a size of 0 disables a level. Only the misses of
+one level are looked up in the next one (a disabled level passes every
+access on), the same for TLB and STLB. The model is deterministic, so the
+numbers only depend on the arguments.
+*/
+
+#include "hilbertpiano_orders.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+class cache_level {
+public:
+  cache_level(std::uint64_t size, unsigned ways, unsigned line)
+      : ways(ways ? ways : 1), shift(0) {
+    while ((1u << shift) < line)
+      shift++;
+    sets = size / ((std::uint64_t)this->ways << shift);
+    if (sets == 0 && size)
+      sets = 1;
+    tags.assign(sets * this->ways, ~0ull);
+    stamps.assign(sets * this->ways, 0);
+  }
+  bool enabled() const { return sets != 0; }
+  // true on hit, the line is inserted on a miss (LRU replacement)
+  bool access(std::uint64_t addr) {
+    std::uint64_t tag = addr >> shift;
+    std::size_t base = (tag % sets) * ways, victim = base;
+    clock++;
+    for (std::size_t i = base; i < base + ways; i++) {
+      if (tags[i] == tag) {
+        stamps[i] = clock;
+        return true;
+      }
+      if (stamps[i] < stamps[victim])
+        victim = i;
+    }
+    tags[victim] = tag;
+    stamps[victim] = clock;
+    misses++;
+    return false;
+  }
+  std::uint64_t misses = 0;
+
+private:
+  unsigned ways, shift;
+  std::uint64_t sets, clock = 0;
+  std::vector<std::uint64_t> tags, stamps;
+};
+
+enum dst_layout { dst_none, dst_row, dst_col, dst_tile };
+
+struct config {
+  std::uint64_t elem = 4, stride = 0, line = 64, page = 4096;
+  int stencil = 0;
+  dst_layout dst = dst_none;
+  std::uint64_t dst_stride = 0, tile = 0;
+  std::uint64_t l1 = 32 << 10, l1_ways = 8, l2 = 1 << 20, l2_ways = 16,
+                l3 = 32 << 20, l3_ways = 16;
+  std::uint64_t tlb = 64, tlb_ways = 4, stlb = 1536, stlb_ways = 12;
+};
+
+class memory_model {
+public:
+  explicit memory_model(const config &c)
+      : c(c), l1(c.l1, c.l1_ways, c.line), l2(c.l2, c.l2_ways, c.line),
+        l3(c.l3, c.l3_ways, c.line), tlb(c.tlb * c.page, c.tlb_ways, c.page),
+        stlb(c.stlb * c.page, c.stlb_ways, c.page) {}
+  void operator()(std::uint64_t addr) {
+    accesses++;
+    if (!(l1.enabled() && l1.access(addr)) && !(l2.enabled() && l2.access(addr)) &&
+        l3.enabled())
+      l3.access(addr);
+    if (!(tlb.enabled() && tlb.access(addr)) && stlb.enabled())
+      stlb.access(addr);
+  }
+  void print(const char *name) const {
+    printf("%-10s %14llu %12llu %12llu %12llu %12llu %12llu\n", name,
+           (unsigned long long)accesses, (unsigned long long)l1.misses,
+           (unsigned long long)l2.misses, (unsigned long long)l3.misses,
+           (unsigned long long)tlb.misses, (unsigned long long)stlb.misses);
+  }
+
+private:
+  config c;
+  cache_level l1, l2, l3, tlb, stlb;
+  std::uint64_t accesses = 0;
+};
+
+template <typename Order>
+static void simulate(int ww, int hh, const config &c) {
+  memory_model m(c);
+  auto src = [&](int x, int y) {
+    return (std::uint64_t)y * c.stride + (std::uint64_t)x * c.elem;
+  };
+  std::uint64_t base = (src(ww - 1, hh - 1) + c.elem + c.page - 1) / c.page * c.page;
+  std::uint64_t tiles_per_row = c.tile ? (ww + c.tile - 1) / c.tile : 0;
+  spacefill_order<Order>(ww, hh, [&](int x, int y, char) {
+    m(src(x, y));
+    for (int r = 1; r <= c.stencil; r++) {
+      if (x - r >= 0)
+        m(src(x - r, y));
+      if (x + r < ww)
+        m(src(x + r, y));
+      if (y - r >= 0)
+        m(src(x, y - r));
+      if (y + r < hh)
+        m(src(x, y + r));
+    }
+    switch (c.dst) {
+    case dst_row:
+      m(base + (std::uint64_t)y * c.dst_stride + (std::uint64_t)x * c.elem);
+      break;
+    case dst_col:
+      m(base + (std::uint64_t)x * c.dst_stride + (std::uint64_t)y * c.elem);
+      break;
+    case dst_tile: {
+      std::uint64_t t = (y / c.tile) * tiles_per_row + x / c.tile;
+      m(base + ((t * c.tile + y % c.tile) * c.tile + x % c.tile) * c.elem);
+      break;
+    }
+    case dst_none:
+      break;
+    }
+  });
+  m.print(Order::name());
+}
+
+static std::uint64_t parse_size(const char *s) {
+  char *end;
+  std::uint64_t v = strtoull(s, &end, 10);
+  if (*end == 'K' || *end == 'k')
+    v <<= 10;
+  else if (*end == 'M' || *end == 'm')
+    v <<= 20;
+  else if (*end == 'G' || *end == 'g')
+    v <<= 30;
+  return v;
+}
+
+static void parse_pair(const char *s, std::uint64_t &size, std::uint64_t &ways) {
+  size = parse_size(s);
+  const char *colon = strchr(s, ':');
+  if (colon)
+    ways = strtoull(colon + 1, nullptr, 10);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: sfc_cachesim W H [--elem B] [--stride B] "
+                    "[--stencil R] [--dst row|col|tile:T] [--dst-stride B] "
+                    "[--line B] [--l1 S:W] [--l2 S:W] [--l3 S:W] [--page B] "
+                    "[--tlb N:W] [--stlb N:W]\n");
+    return 2;
+  }
+  int ww = atoi(argv[1]), hh = atoi(argv[2]);
+  config c;
+  for (int i = 3; i < argc; i += 2) {
+    const char *o = argv[i], *v = argv[i + 1];
+    if (i + 1 == argc) {
+      fprintf(stderr, "sfc_cachesim: missing value for %s\n", o);
+      return 2;
+    }
+    if (!strcmp(o, "--elem"))
+      c.elem = parse_size(v);
+    else if (!strcmp(o, "--stride"))
+      c.stride = parse_size(v);
+    else if (!strcmp(o, "--stencil"))
+      c.stencil = atoi(v);
+    else if (!strcmp(o, "--dst") && !strcmp(v, "row"))
+      c.dst = dst_row;
+    else if (!strcmp(o, "--dst") && !strcmp(v, "col"))
+      c.dst = dst_col;
+    else if (!strcmp(o, "--dst") && !strncmp(v, "tile:", 5)) {
+      c.dst = dst_tile;
+      c.tile = strtoull(v + 5, nullptr, 10);
+    } else if (!strcmp(o, "--dst-stride"))
+      c.dst_stride = parse_size(v);
+    else if (!strcmp(o, "--line"))
+      c.line = parse_size(v);
+    else if (!strcmp(o, "--page"))
+      c.page = parse_size(v);
+    else if (!strcmp(o, "--l1"))
+      parse_pair(v, c.l1, c.l1_ways);
+    else if (!strcmp(o, "--l2"))
+      parse_pair(v, c.l2, c.l2_ways);
+    else if (!strcmp(o, "--l3"))
+      parse_pair(v, c.l3, c.l3_ways);
+    else if (!strcmp(o, "--tlb"))
+      parse_pair(v, c.tlb, c.tlb_ways);
+    else if (!strcmp(o, "--stlb"))
+      parse_pair(v, c.stlb, c.stlb_ways);
+    else {
+      fprintf(stderr, "sfc_cachesim: bad argument %s\n", o);
+      return 2;
+    }
+  }
+  if (ww <= 0 || hh <= 0 || !c.elem || !c.line || !c.page || c.stencil < 0 ||
+      (c.dst == dst_tile && !c.tile)) {
+    fprintf(stderr, "sfc_cachesim: bad size\n");
+    return 2;
+  }
+  if (!c.stride)
+    c.stride = (std::uint64_t)ww * c.elem;
+  if (!c.dst_stride)
+    c.dst_stride = (std::uint64_t)(c.dst == dst_col ? hh : ww) * c.elem;
+
+  printf("%-10s %14s %12s %12s %12s %12s %12s\n", "order", "accesses",
+         "L1 miss", "L2 miss", "L3 miss", "TLB miss", "STLB miss");
+  namespace order = hilbert_piano::order;
+  simulate<order::tautenhahn>(ww, hh, c);
+  simulate<order::row_major>(ww, hh, c);
+  simulate<order::snake>(ww, hh, c);
+  simulate<order::morton>(ww, hh, c);
+  simulate<order::hilbert>(ww, hh, c);
+  return 0;
+}
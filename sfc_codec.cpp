@@ -0,0 +1,146 @@
+/*
+Round trip of binary PGM/PPM images (P5/P6, maxval 255) through the curve
+ordered codec of hilbertpiano_codec.hpp.
+
+  sfc_codec c IN.pgm OUT.sfci [CHUNK_CELLS] [ORDER]  encode
+  sfc_codec d IN.sfci OUT.pgm [THREADS]              decode
+  sfc_codec s IN.sfci OUT.pgm                        decode chunk by chunk as read
+  sfc_codec t IN.pgm [CHUNK_CELLS]                   encode + decode, print the
+                                                     ratio and speed of the curve
+                                                     and of row-major
+
+ORDER is tautenhahn (default), row-major, snake, morton or hilbert.
+*/
+
+#include "hilbertpiano_codec.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace codec = hilbert_piano::codec;
+
+static std::vector<unsigned char> read_file(const char *name) {
+  std::ifstream in(name, std::ios::binary);
+  if (!in)
+    throw std::runtime_error(std::string("cannot open ") + name);
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), {});
+}
+
+static codec::image read_pnm(const char *name) {
+  std::vector<unsigned char> data = read_file(name);
+  std::string head((const char *)data.data(), std::min<std::size_t>(data.size(), 256));
+  std::istringstream s(head);
+  std::string magic;
+  int maxval = 0;
+  codec::image img;
+  s >> magic >> img.width >> img.height >> maxval;
+  if (!s || (magic != "P5" && magic != "P6") || maxval != 255)
+    throw std::runtime_error(std::string(name) + ": not a 8-bit P5/P6 file");
+  img.channels = magic == "P5" ? 1 : 3;
+  std::size_t offset = (std::size_t)s.tellg() + 1, n = (std::size_t)img.width * img.height * img.channels;
+  if (data.size() < offset + n)
+    throw std::runtime_error(std::string(name) + ": truncated");
+  img.pixels.assign(data.begin() + offset, data.begin() + offset + n);
+  return img;
+}
+
+static void write_pnm(const char *name, const codec::image &img) {
+  std::ofstream out(name, std::ios::binary);
+  out << (img.channels == 1 ? "P5" : "P6") << "\n" << img.width << " " << img.height << "\n255\n";
+  out.write((const char *)img.pixels.data(), img.pixels.size());
+  if (!out)
+    throw std::runtime_error(std::string("cannot write ") + name);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// encodes img in the order named name, prints ratio and speed
+static std::string encode(const codec::image &img, std::uint32_t chunk, const char *name) {
+  std::ostringstream out;
+  auto t = std::chrono::steady_clock::now();
+  bool known = false;
+  for (unsigned id = 0; id < 5; id++)
+    codec::with_order(id, [&](auto order) {
+      using Order = decltype(order);
+      if (strcmp(name, Order::name()))
+        return;
+      codec::encode<Order>(img.pixels.data(), img.width, img.height, img.channels,
+                           (std::size_t)img.width * img.channels, out, chunk);
+      known = true;
+    });
+  if (!known)
+    throw std::runtime_error(std::string("unknown order ") + name);
+  double encode_time = seconds_since(t);
+  std::string bytes = out.str();
+  printf("%-10s %zu -> %zu bytes (%.3f bpp), encode %.1f MB/s\n", name, img.pixels.size(),
+         bytes.size(), 8.0 * bytes.size() / ((double)img.width * img.height),
+         img.pixels.size() / encode_time / 1e6);
+  return bytes;
+}
+
+int main(int argc, char **argv) try {
+  if (argc < 3 || (argv[1][0] != 't' && argc < 4)) {
+    fprintf(stderr, "usage: sfc_codec c|d|s|t IN [OUT] [CHUNK_CELLS|THREADS] [ORDER]\n");
+    return 2;
+  }
+  char mode = argv[1][0];
+  if (mode == 'c') {
+    codec::image img = read_pnm(argv[2]);
+    std::uint32_t chunk = argc > 4 ? (std::uint32_t)atol(argv[4]) : 1 << 16;
+    std::string bytes = encode(img, chunk, argc > 5 ? argv[5] : "tautenhahn");
+    std::ofstream f(argv[3], std::ios::binary);
+    f.write(bytes.data(), bytes.size());
+    if (!f)
+      throw std::runtime_error(std::string("cannot write ") + argv[3]);
+    return 0;
+  }
+  if (mode == 't') {
+    codec::image img = read_pnm(argv[2]);
+    std::uint32_t chunk = argc > 3 ? (std::uint32_t)atol(argv[3]) : 1 << 16;
+    bool lossless = true;
+    for (const char *name : {"tautenhahn", "row-major"}) {
+      std::string bytes = encode(img, chunk, name);
+      auto t = std::chrono::steady_clock::now();
+      codec::image back = codec::decode((const unsigned char *)bytes.data(), bytes.size());
+      double decode_time = seconds_since(t);
+      printf("%-10s decode %.1f MB/s, %s\n", name, img.pixels.size() / decode_time / 1e6,
+             back.pixels == img.pixels ? "lossless" : "MISMATCH");
+      lossless = lossless && back.pixels == img.pixels;
+    }
+    return lossless ? 0 : 1;
+  }
+  if (mode == 'd') {
+    std::vector<unsigned char> data = read_file(argv[2]);
+    unsigned threads = argc > 4 ? (unsigned)atoi(argv[4]) : 0;
+    write_pnm(argv[3], codec::decode(data.data(), data.size(), threads));
+    return 0;
+  }
+  if (mode == 's') {
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in)
+      throw std::runtime_error(std::string("cannot open ") + argv[2]);
+    codec::header h = codec::read_header(in);
+    codec::image img;
+    img.width = h.width;
+    img.height = h.height;
+    img.channels = h.channels;
+    img.pixels.resize((std::size_t)h.cells() * h.channels);
+    codec::decode(in, h, img.pixels.data(), (std::size_t)h.width * h.channels);
+    write_pnm(argv[3], img);
+    return 0;
+  }
+  fprintf(stderr, "sfc_codec: unknown mode %s\n", argv[1]);
+  return 2;
+} catch (const std::exception &e) {
+  fprintf(stderr, "sfc_codec: %s\n", e.what());
+  return 1;
+}
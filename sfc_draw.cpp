@@ -0,0 +1,57 @@
+/*
+Draws the curve of a W x H grid, the format follows the file extension:
+
+  sfc_draw W H OUT.svg|OUT.ps|OUT.pgm|OUT.ppm [SCALE]
+
+SCALE is the size of a cell in output units/pixels (default 4).
+*/
+
+#include "hilbertpiano_draw.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+static bool ends_with(const std::string &s, const char *suffix) {
+  std::size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+int main(int argc, char **argv) try {
+  if (argc < 4) {
+    fprintf(stderr, "usage: sfc_draw W H OUT.svg|OUT.ps|OUT.pgm|OUT.ppm [SCALE]\n");
+    return 2;
+  }
+  int ww = atoi(argv[1]), hh = atoi(argv[2]);
+  int scale = argc > 4 ? atoi(argv[4]) : 4;
+  std::string out = argv[3];
+  if (ww <= 0 || hh <= 0 || scale <= 0) {
+    fprintf(stderr, "sfc_draw: bad size\n");
+    return 2;
+  }
+  if (ends_with(out, ".pgm") || ends_with(out, ".ppm")) {
+    hilbert_piano::raster_writer raster(out, ww, hh, scale, ends_with(out, ".ppm") ? 3 : 1);
+    hilbert_piano::draw(ww, hh, raster);
+    return 0;
+  }
+  std::ofstream file(out, std::ios::binary);
+  if (ends_with(out, ".svg")) {
+    hilbert_piano::svg_writer svg(file, ww, hh, scale);
+    hilbert_piano::draw(ww, hh, svg);
+  } else if (ends_with(out, ".ps") || ends_with(out, ".eps")) {
+    hilbert_piano::ps_writer ps(file, ww, hh, scale);
+    hilbert_piano::draw(ww, hh, ps);
+  } else {
+    fprintf(stderr, "sfc_draw: unknown format %s\n", out.c_str());
+    return 2;
+  }
+  if (!file.flush())
+    throw std::runtime_error("cannot write " + out);
+  return 0;
+} catch (const std::exception &e) {
+  fprintf(stderr, "sfc_draw: %s\n", e.what());
+  return 1;
+}
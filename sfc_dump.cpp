@@ -0,0 +1,123 @@
+/*
+Writes the curve of a W x H grid, or its inverse table, to one file.
+
+  sfc_dump W H OUT [--inverse] [--shard I/N]
+
+Forward file: cell number i of the curve as uint32 x, uint32 y at offset 8*i.
+Inverse file: curve index of cell x, y as uint64 at offset 8*(y*W+x).
+Both little-endian (host order on x86/ARM).
+
+With --shard I/N the process writes only its part of the file: curve
+indices [I*total/N, (I+1)*total/N) of the forward file, generated with
+spacefill_range(), or rows [I*H/N, (I+1)*H/N) of the inverse file,
+generated with spacefill_clip() a band of rows at a time so every band
+is one write. Shards need no coordination: start N processes (on one or
+several machines sharing the storage) with I = 0..N-1 and the same W, H,
+OUT.
+*/
+
+#include "hilbertpiano.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static void fail(const char *what) {
+  fprintf(stderr, "sfc_dump: %s: %s\n", what, strerror(errno));
+  exit(1);
+}
+
+static void write_at(int fd, const void *data, std::size_t size, off_t offset) {
+  const char *p = (const char *)data;
+  while (size) {
+    ssize_t n = pwrite(fd, p, size, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      fail("pwrite");
+    }
+    p += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: sfc_dump W H OUT [--inverse] [--shard I/N]\n");
+    return 2;
+  }
+  int ww = atoi(argv[1]), hh = atoi(argv[2]);
+  const char *out = argv[3];
+  bool inverse = false;
+  long shard = 0, shards = 1;
+  for (int i = 4; i < argc; i++) {
+    if (!strcmp(argv[i], "--inverse"))
+      inverse = true;
+    else if (!strcmp(argv[i], "--shard") && i + 1 < argc &&
+             sscanf(argv[++i], "%ld/%ld", &shard, &shards) == 2)
+      ;
+    else {
+      fprintf(stderr, "sfc_dump: bad argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (ww <= 0 || hh <= 0 || shards <= 0 || shard < 0 || shard >= shards) {
+    fprintf(stderr, "sfc_dump: bad size or shard\n");
+    return 2;
+  }
+
+  std::int64_t total = (std::int64_t)ww * hh;
+  std::int64_t begin = total / shards * shard + total % shards * shard / shards;
+  std::int64_t end =
+      total / shards * (shard + 1) + total % shards * (shard + 1) / shards;
+
+  int fd = open(out, O_WRONLY | O_CREAT, 0644); // no O_TRUNC, shards share it
+  if (fd < 0)
+    fail(out);
+  if (ftruncate(fd, (off_t)total * 8) < 0) // same size from every shard
+    fail("ftruncate");
+
+  if (!inverse) {
+    // the slice is contiguous in the file, write it in large blocks
+    std::vector<std::uint32_t> buf;
+    buf.reserve(1 << 20);
+    std::int64_t first = begin;
+    spacefill_range(ww, hh, begin, end, [&](int x, int y, std::int64_t) {
+      buf.push_back(x);
+      buf.push_back(y);
+      if (buf.size() == buf.capacity()) {
+        write_at(fd, buf.data(), buf.size() * 4, (off_t)first * 8);
+        first += buf.size() / 2;
+        buf.clear();
+      }
+    });
+    write_at(fd, buf.data(), buf.size() * 4, (off_t)first * 8);
+  } else {
+    // rows of the shard in bands of about 64 MB, each band is contiguous in
+    // the file; nodes outside the band are skipped whole by spacefill_clip
+    int y0 = (int)((std::int64_t)hh * shard / shards);
+    int y1 = (int)((std::int64_t)hh * (shard + 1) / shards);
+    int rows = (int)std::max<std::int64_t>(1, (64 << 20) / 8 / ww);
+    std::vector<std::uint64_t> band((std::size_t)std::min(rows, y1 - y0) * ww);
+    for (int y = y0; y < y1; y += rows) {
+      int h = std::min(rows, y1 - y);
+      spacefill_clip(ww, hh, hilbert_piano::rect{0, y, ww, h},
+                     [&](int x, int cy, std::int64_t index) {
+                       band[(std::size_t)(cy - y) * ww + x] = index;
+                     });
+      write_at(fd, band.data(), (std::size_t)h * ww * 8, (off_t)y * ww * 8);
+    }
+  }
+  if (close(fd) < 0)
+    fail("close");
+  return 0;
+}
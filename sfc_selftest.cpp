@@ -0,0 +1,528 @@
+/*
+Self-test of hilbertpiano.hpp and the hilbertpiano_*.hpp headers, prints a
+line for every failed check.
+
+  sfc_selftest
+*/
+
+#include "hilbertpiano.hpp"
+#include "hilbertpiano_orders.hpp"
+#include "hilbertpiano_pipeline.hpp"
+#include "hilbertpiano_prefetch.hpp"
+#include "hilbertpiano_tables.hpp"
+#include "hilbertpiano_transpose.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct indexed_cell {
+  int x, y;
+  std::int64_t index;
+};
+
+// spacefill_clip() must give the cells of the viewport with the same curve
+// index spacefill_range() gives them; on grids past INT_MAX cells as well
+static bool check_clip(int ww, int hh, hilbert_piano::rect v) {
+  std::vector<indexed_cell> cells;
+  spacefill_clip(ww, hh, v, [&](int x, int y, std::int64_t index) {
+    cells.push_back(indexed_cell{x, y, index});
+  });
+  if ((std::int64_t)cells.size() != (std::int64_t)v.w * v.h)
+    return false;
+  for (std::size_t i = 0; i < cells.size(); i++) {
+    const indexed_cell &c = cells[i];
+    int n = 0;
+    bool same = false;
+    spacefill_range(ww, hh, c.index, c.index + 1,
+                    [&](int x, int y, std::int64_t) {
+                      n++;
+                      same = x == c.x && y == c.y;
+                    });
+    if (n != 1 || !same || (i > 0 && cells[i - 1].index >= c.index))
+      return false;
+  }
+  return true;
+}
+
+struct curve_cell {
+  int x, y;
+  char dir;
+  bool operator!=(const curve_cell &o) const {
+    return x != o.x || y != o.y || dir != o.dir;
+  }
+};
+
+// callback with node hooks, so go() takes the plain recursion everywhere
+struct hooked_render {
+  std::vector<curve_cell> &cells;
+  bool enter(int, int, int, int, int, int, char) { return true; }
+  void leave(int, int, int, int, int, int, char) {}
+  void operator()(int x, int y, char dir) {
+    cells.push_back(curve_cell{x, y, dir});
+  }
+};
+
+// the table-driven Hilbert fast path must give the same cells and dir as
+// the recursion
+static bool check_hilbert(int ww, int hh) {
+  std::vector<curve_cell> fast, plain;
+  spacefill(ww, hh, [&](int x, int y, char dir) {
+    fast.push_back(curve_cell{x, y, dir});
+  });
+  hooked_render r{plain};
+  spacefill(ww, hh, r);
+  if (fast.size() != plain.size())
+    return false;
+  for (std::size_t i = 0; i < fast.size(); i++)
+    if (fast[i] != plain[i])
+      return false;
+  return true;
+}
+
+// every cell exactly once, the padded Hilbert order of long thin grids
+// covers a 2^k square past INT_MAX cells
+template <typename Order> static bool check_order(int ww, int hh) {
+  std::vector<char> seen((std::size_t)ww * hh);
+  std::int64_t n = 0;
+  bool ok = true;
+  spacefill_order<Order>(ww, hh, [&](int x, int y, char) {
+    if (x < 0 || x >= ww || y < 0 || y >= hh || seen[(std::size_t)y * ww + x]++)
+      ok = false;
+    n++;
+  });
+  return ok && n == (std::int64_t)ww * hh;
+}
+
+static std::vector<hilbert_piano::point> curve(int ww, int hh) {
+  std::vector<hilbert_piano::point> cells;
+  spacefill(ww, hh, [&](int x, int y, char) {
+    cells.push_back(hilbert_piano::point{x, y});
+  });
+  return cells;
+}
+
+// cells reach render() in curve order with their dir, address() sees every
+// cell in curve order distance cells ahead of render()
+static bool check_prefetch(int ww, int hh, int distance) {
+  std::vector<curve_cell> ref, got;
+  spacefill(ww, hh, [&](int x, int y, char dir) {
+    ref.push_back(curve_cell{x, y, dir});
+  });
+  std::size_t addressed = 0;
+  bool ok = true;
+  spacefill_prefetch(
+      ww, hh, distance,
+      [&](int x, int y) -> const void * {
+        if (addressed >= ref.size() || ref[addressed].x != x ||
+            ref[addressed].y != y)
+          ok = false;
+        addressed++;
+        return &ref[0];
+      },
+      [&](int x, int y, char dir) {
+        // distance <= 0 is a plain spacefill(), address() is not called
+        std::size_t want =
+            distance > 0 ? std::min(got.size() + distance + 1, ref.size()) : 0;
+        if (addressed != want)
+          ok = false;
+        got.push_back(curve_cell{x, y, dir});
+      });
+  if (!ok || got.size() != ref.size())
+    return false;
+  for (std::size_t i = 0; i < ref.size(); i++)
+    if (got[i] != ref[i])
+      return false;
+  return true;
+}
+
+// every node covers the cells of its area with [begin, end) and sums leaf()
+// over them, children come before their parent and the root is last;
+// min_cells and max_depth keep exactly the matching nodes of the full tree
+static bool check_reduce(int ww, int hh) {
+  std::vector<hilbert_piano::point> ref = curve(ww, hh);
+  auto leaf = [](int x, int y) { return (std::int64_t)x * 131 + y * 7 + 1; };
+  auto sum = [](std::int64_t a, std::int64_t b) { return a + b; };
+  auto nodes = spacefill_reduce(ww, hh, (std::int64_t)0, leaf, sum);
+  if (nodes.empty())
+    return false;
+  const auto &root = nodes.back();
+  if (root.begin != 0 || root.end != (std::int64_t)ref.size() ||
+      root.depth != 0 || root.area.x != 0 || root.area.y != 0 ||
+      root.area.w != ww || root.area.h != hh)
+    return false;
+  for (std::size_t i = 0; i < nodes.size(); i++) {
+    const auto &n = nodes[i];
+    if (n.begin < 0 || n.end > (std::int64_t)ref.size() ||
+        n.end - n.begin != (std::int64_t)n.area.w * n.area.h)
+      return false;
+    std::int64_t value = 0;
+    for (std::int64_t c = n.begin; c < n.end; c++) {
+      const hilbert_piano::point &p = ref[c];
+      if (p.x < n.area.x || p.x >= n.area.x + n.area.w || p.y < n.area.y ||
+          p.y >= n.area.y + n.area.h)
+        return false;
+      value += leaf(p.x, p.y);
+    }
+    if (value != n.value)
+      return false;
+    // a later node that overlaps is an ancestor
+    for (std::size_t j = i + 1; j < nodes.size(); j++) {
+      const auto &a = nodes[j];
+      if (a.end <= n.begin || a.begin >= n.end)
+        continue;
+      if (a.begin > n.begin || a.end < n.end || a.depth >= n.depth)
+        return false;
+    }
+  }
+  const struct {
+    std::int64_t min_cells;
+    int max_depth;
+  } filters[] = {{10, 1 << 30}, {1, 2}, {7, 3}, {1, 0}, {1 << 30, 1 << 30}};
+  for (const auto &f : filters) {
+    auto kept = spacefill_reduce(ww, hh, (std::int64_t)0, leaf, sum,
+                                 f.min_cells, f.max_depth);
+    std::size_t k = 0;
+    for (const auto &n : nodes)
+      if (n.end - n.begin >= f.min_cells && n.depth <= f.max_depth) {
+        if (k == kept.size() || kept[k].begin != n.begin ||
+            kept[k].end != n.end || kept[k].depth != n.depth ||
+            kept[k].value != n.value)
+          return false;
+        k++;
+      }
+    if (k != kept.size())
+      return false;
+  }
+  return true;
+}
+
+// op(src, src_stride, dst, dst_stride, block_cells) element by element
+// against source(dx, dy), the source cell that lands at dx, dy; rows have
+// padding that must stay untouched, dst is hh x ww when swapped
+template <typename Op, typename Source>
+static bool check_remap(int ww, int hh, bool swapped, Op op, Source source) {
+  const std::uint32_t pad = 0xdeadbeef;
+  int dw = swapped ? hh : ww, dh = swapped ? ww : hh;
+  std::size_t src_stride = ww + 3, dst_stride = dw + 5;
+  std::vector<std::uint32_t> src(src_stride * hh, pad);
+  for (int y = 0; y < hh; y++)
+    for (int x = 0; x < ww; x++)
+      src[y * src_stride + x] = (std::uint32_t)y << 16 | x;
+  for (std::int64_t block_cells : {0, 1, 5}) {
+    std::vector<std::uint32_t> dst(dst_stride * dh, pad);
+    op(src.data(), src_stride, dst.data(), dst_stride, block_cells);
+    for (int y = 0; y < dh; y++)
+      for (std::size_t x = 0; x < dst_stride; x++) {
+        std::uint32_t want = pad;
+        if (x < (std::size_t)dw) {
+          hilbert_piano::point s = source((int)x, y);
+          want = (std::uint32_t)s.y << 16 | s.x;
+        }
+        if (dst[y * dst_stride + x] != want)
+          return false;
+      }
+  }
+  return true;
+}
+
+static bool check_transpose(int ww, int hh) {
+  using hilbert_piano::point;
+  using T = std::uint32_t;
+  auto transpose = [&](const T *s, std::size_t ss, T *d, std::size_t ds,
+                       std::int64_t b) {
+    hilbert_piano::transpose(s, ww, hh, ss, d, ds, b);
+  };
+  auto rotate90 = [&](const T *s, std::size_t ss, T *d, std::size_t ds,
+                      std::int64_t b) {
+    hilbert_piano::rotate90(s, ww, hh, ss, d, ds, b);
+  };
+  auto rotate180 = [&](const T *s, std::size_t ss, T *d, std::size_t ds,
+                       std::int64_t b) {
+    hilbert_piano::rotate180(s, ww, hh, ss, d, ds, b);
+  };
+  auto rotate270 = [&](const T *s, std::size_t ss, T *d, std::size_t ds,
+                       std::int64_t b) {
+    hilbert_piano::rotate270(s, ww, hh, ss, d, ds, b);
+  };
+  return check_remap(ww, hh, true, transpose,
+                     [](int x, int y) { return point{y, x}; }) &&
+         check_remap(ww, hh, true, rotate90,
+                     [&](int x, int y) { return point{y, hh - 1 - x}; }) &&
+         check_remap(ww, hh, false, rotate180, [&](int x, int y) {
+           return point{ww - 1 - x, hh - 1 - y};
+         }) &&
+         check_remap(ww, hh, true, rotate270,
+                     [&](int x, int y) { return point{ww - 1 - y, x}; });
+}
+
+// every curve index exactly once, at its cell, with batches smaller than
+// the pool and more consumers than free batches
+static bool check_pipeline(int ww, int hh, unsigned consumers,
+                           std::size_t batch_size, std::size_t batches) {
+  std::vector<hilbert_piano::point> ref = curve(ww, hh);
+  std::unique_ptr<std::atomic<int>[]> seen(new std::atomic<int>[ref.size()]);
+  for (std::size_t i = 0; i < ref.size(); i++)
+    seen[i] = 0;
+  std::atomic<bool> ok{true};
+  hilbert_piano::spacefill_pipelined(
+      ww, hh, consumers,
+      [&](const hilbert_piano::point *pts, std::size_t n, std::size_t first) {
+        if (n == 0 || n > batch_size || first + n > ref.size()) {
+          ok = false;
+          return;
+        }
+        for (std::size_t i = 0; i < n; i++) {
+          if (pts[i].x != ref[first + i].x || pts[i].y != ref[first + i].y)
+            ok = false;
+          seen[first + i]++;
+        }
+      },
+      batch_size, batches);
+  for (std::size_t i = 0; i < ref.size(); i++)
+    if (seen[i] != 1)
+      ok = false;
+  return ok;
+}
+
+// global index, rank and order of the occupied cells against a plain walk
+static bool check_masked(int ww, int hh, const std::vector<unsigned char> &mask) {
+  struct masked_cell {
+    int x, y;
+    std::int64_t index, rank;
+  };
+  std::vector<masked_cell> want, got;
+  std::int64_t index = 0;
+  spacefill(ww, hh, [&](int x, int y, char) {
+    if (mask[(std::size_t)y * ww + x])
+      want.push_back(masked_cell{x, y, index, (std::int64_t)want.size()});
+    index++;
+  });
+  hilbert_piano::occupancy occ(ww, hh, mask.data(), ww);
+  spacefill_masked(occ, [&](int x, int y, std::int64_t index, std::int64_t rank) {
+    got.push_back(masked_cell{x, y, index, rank});
+  });
+  if (got.size() != want.size() || occ.count() != want.size())
+    return false;
+  for (std::size_t i = 0; i < got.size(); i++)
+    if (got[i].x != want[i].x || got[i].y != want[i].y ||
+        got[i].index != want[i].index || got[i].rank != want[i].rank)
+      return false;
+  return true;
+}
+
+// scattered (percent of the cells), clustered (discs) and edge case masks
+static void check_masks(int ww, int hh) {
+  std::mt19937 random(ww * 7919 + hh);
+  std::vector<unsigned char> mask((std::size_t)ww * hh);
+  for (int percent : {0, 5, 50, 100}) {
+    for (auto &m : mask)
+      m = (int)(random() % 100) < percent;
+    if (!check_masked(ww, hh, mask))
+      printf("masked %d,%d %d%% fail!\n", ww, hh, percent);
+  }
+  for (int y = 0; y < hh; y++)
+    for (int x = 0; x < ww; x++) {
+      int dx = x % 97 - 40, dy = y % 89 - 50;
+      mask[(std::size_t)y * ww + x] = dx * dx + dy * dy < 30 * 30;
+    }
+  if (!check_masked(ww, hh, mask))
+    printf("masked %d,%d discs fail!\n", ww, hh);
+  std::fill(mask.begin(), mask.end(), 0);
+  mask[mask.size() - 1] = 1;
+  if (!check_masked(ww, hh, mask))
+    printf("masked %d,%d last cell fail!\n", ww, hh);
+}
+
+// at() and index() against spacefill(), and the checksum
+static bool check_table(const hilbert_piano::curve_table &t, int ww, int hh) {
+  std::vector<hilbert_piano::point> ref = curve(ww, hh);
+  if (t.width() != ww || t.height() != hh || t.cells() != ref.size() ||
+      !t.verify())
+    return false;
+  for (std::size_t i = 0; i < ref.size(); i++)
+    if (t.at(i).x != ref[i].x || t.at(i).y != ref[i].y ||
+        t.index(ref[i].x, ref[i].y) != i)
+      return false;
+  return true;
+}
+
+static ino_t inode(const std::string &file) {
+  struct stat st;
+  return stat(file.c_str(), &st) < 0 ? 0 : st.st_ino;
+}
+
+// overwrites size bytes at offset of file
+static void patch(const std::string &file, long offset, const void *data,
+                  std::size_t size) {
+  FILE *f = fopen(file.c_str(), "r+b");
+  if (f) {
+    fseek(f, offset, SEEK_SET);
+    fwrite(data, 1, size, f);
+    fclose(f);
+  }
+}
+
+// build, map again without building, rebuild on a header or size that does
+// not match, verify() on a damaged table, 8 threads racing to build one
+static void check_tables() {
+  char dir[] = "/tmp/sfc_selftest.XXXXXX";
+  if (!mkdtemp(dir)) {
+    printf("tables mkdtemp fail!\n");
+    return;
+  }
+  hilbert_piano::table_cache cache(dir);
+  const int sizes[][2] = {{1, 1}, {37, 23}, {64, 64}, {300, 200}};
+  for (const auto &s : sizes) {
+    if (!check_table(cache.open(s[0], s[1]), s[0], s[1]))
+      printf("table %d,%d fail!\n", s[0], s[1]);
+    ino_t built = inode(cache.path(s[0], s[1]));
+    if (!check_table(cache.open(s[0], s[1]), s[0], s[1]) ||
+        inode(cache.path(s[0], s[1])) != built)
+      printf("table %d,%d reopen fail!\n", s[0], s[1]);
+  }
+
+  // table of 23 x 37 under the name of 37 x 23: same file size, other
+  // header; open() must build a new file (a new inode) for each mismatch
+  std::string file = cache.path(37, 23);
+  cache.build(23, 37);
+  rename(cache.path(23, 37).c_str(), file.c_str());
+  ino_t before = inode(file);
+  if (!check_table(cache.open(37, 23), 37, 23) || inode(file) == before)
+    printf("table header mismatch fail!\n");
+  std::uint32_t version = 99;
+  patch(file, 4, &version, 4);
+  before = inode(file);
+  if (!check_table(cache.open(37, 23), 37, 23) || inode(file) == before)
+    printf("table version mismatch fail!\n");
+  before = inode(file);
+  if (truncate(file.c_str(), 64 + 12 * 37 * 23 - 1) < 0 ||
+      !check_table(cache.open(37, 23), 37, 23) || inode(file) == before)
+    printf("table size mismatch fail!\n");
+  std::uint32_t x = 5;
+  patch(file, 64 + 8 * 100, &x, 4);
+  if (cache.open(37, 23).verify())
+    printf("table verify fail!\n");
+
+  bool rejected = true;
+  for (const auto &s : {std::make_pair(0, 5), std::make_pair(5, -1),
+                        std::make_pair((1 << 29) + 1, 1),
+                        std::make_pair(1 << 17, 1 << 17)})
+    try {
+      cache.open(s.first, s.second);
+      rejected = false;
+    } catch (const std::invalid_argument &) {
+    }
+  if (!rejected)
+    printf("table bad size fail!\n");
+
+  std::atomic<bool> ok{true};
+  std::vector<std::thread> racers;
+  for (int i = 0; i < 8; i++)
+    racers.emplace_back([&] {
+      try {
+        if (!check_table(cache.open(257, 129), 257, 129))
+          ok = false;
+      } catch (const std::exception &) {
+        ok = false;
+      }
+    });
+  for (auto &t : racers)
+    t.join();
+  if (!ok)
+    printf("table build race fail!\n");
+
+  // only the finished tables are left, no temporary files
+  DIR *d = opendir(dir);
+  int tables = 0;
+  while (struct dirent *e = d ? readdir(d) : nullptr) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..")
+      continue;
+    if (name.size() < 4 || name.compare(name.size() - 4, 4, ".tbl"))
+      printf("table temporary %s left fail!\n", name.c_str());
+    else
+      tables++;
+    unlink((std::string(dir) + "/" + name).c_str());
+  }
+  if (d)
+    closedir(d);
+  rmdir(dir);
+  if (tables != 5)
+    printf("table files fail!\n");
+}
+
+int main() {
+  for (int ww = 1; ww <= 130; ww++)
+    for (int hh = 1; hh <= 130; hh++)
+      if (!check_hilbert(ww, hh))
+        printf("hilbert %d,%d fail!\n", ww, hh);
+  const int sizes[][2] = {{256, 256},   {1024, 1024}, {2048, 2048},
+                          {512, 768},   {1024, 3072}, {1000, 1024},
+                          {4096, 1024}, {768, 1536},  {1536, 1537}};
+  for (const auto &s : sizes)
+    if (!check_hilbert(s[0], s[1]))
+      printf("hilbert %d,%d fail!\n", s[0], s[1]);
+
+  const int thin[][2] = {{40000, 100}, {33000, 7}, {200000, 5}, {100, 70000}};
+  for (const auto &s : thin)
+    if (!check_order<hilbert_piano::order::hilbert>(s[0], s[1]))
+      printf("order::hilbert %d,%d fail!\n", s[0], s[1]);
+
+  if (!check_pipeline(97, 61, 4, 7, 2) || !check_pipeline(1, 1, 3, 1, 1) ||
+      !check_pipeline(300, 200, 2, 4096, 64))
+    printf("pipeline fail!\n");
+
+  for (const auto &s : {std::make_pair(37, 23), std::make_pair(64, 64),
+                        std::make_pair(1, 1)})
+    for (int distance : {-1, 0, 1, 7, 8, 9, 31, 32, 33, 5000})
+      if (!check_prefetch(s.first, s.second, distance))
+        printf("prefetch %d,%d distance %d fail!\n", s.first, s.second,
+               distance);
+
+  const int remapped[][2] = {{1, 1}, {1, 7}, {7, 1}, {2, 2}, {5, 5},
+                             {8, 8}, {13, 6}, {6, 13}, {64, 33}, {100, 37}};
+  for (const auto &s : remapped)
+    if (!check_transpose(s[0], s[1]))
+      printf("transpose/rotate %d,%d fail!\n", s[0], s[1]);
+
+  const int reduced[][2] = {{1, 1}, {2, 3}, {37, 23}, {64, 64}, {100, 7}};
+  for (const auto &s : reduced)
+    if (!check_reduce(s[0], s[1]))
+      printf("reduce %d,%d fail!\n", s[0], s[1]);
+
+  const int masked[][2] = {{1, 1}, {37, 23}, {64, 64}, {300, 200}, {256, 256},
+                           {1000, 777}};
+  for (const auto &s : masked)
+    check_masks(s[0], s[1]);
+
+  check_tables();
+
+  const struct {
+    int ww, hh;
+    hilbert_piano::rect v;
+  } clips[] = {
+      {333, 77, {10, 5, 40, 30}},
+      {65536, 65536, {1000, 1000, 50, 50}},
+      {65536, 65536, {65500, 0, 36, 20}},
+      {131072, 131072, {70000, 129000, 40, 40}},
+      {100000, 100000, {49980, 49990, 30, 25}},
+  };
+  for (const auto &c : clips)
+    if (!check_clip(c.ww, c.hh, c.v))
+      printf("clip %d,%d %d,%d %dx%d fail!\n", c.ww, c.hh, c.v.x, c.v.y, c.v.w,
+             c.v.h);
+  return 0;
+}